@@ -0,0 +1,37 @@
+// List of every asset a scene or prefab references, so they can all be loaded up front.
+
+#pragma once
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace Engine
+{
+    struct AssetManifest
+    {
+        // Paths relative to assets/, like components store them
+        std::vector<std::string> textures;
+        std::vector<std::string> fonts;
+        std::vector<std::string> pfxs;
+        std::vector<std::string> frameAnims;
+
+        uint64_t sourceHash = 0; // Hash of the scene file content the manifest was built from
+
+        // Walks the scene/prefab json. Also opens PFX and FrameAnim files to collect their textures.
+        static AssetManifest scan(const Json::Value& json);
+
+        // Uses "scenes/foo.manifest.json" if it's still valid for sceneFilename, otherwise scans and saves it.
+        static AssetManifest loadOrScan(const std::string& sceneFilename, const Json::Value& sceneJson);
+
+        static std::string getManifestFilename(const std::string& sceneFilename);
+
+        Json::Value serialize() const;
+        void deserialize(const Json::Value& json);
+
+        size_t size() const { return textures.size() + fonts.size() + pfxs.size() + frameAnims.size(); }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Engine/ComponentFactory.h>
+#include <Engine/Handle.h>
 
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
@@ -18,18 +19,39 @@ namespace Engine
 
 	class Component;
 	using ComponentRef = std::shared_ptr<Component>;
+	using ComponentHandle = Handle<Component>;
 
 	class Texture;
 	using TextureRef = std::shared_ptr<Texture>;
 
+	// How often a component's update() runs. A throttled one gets the time since its last update as
+	// deltaTime. fixedUpdate() isn't affected.
+	struct TickPolicy
+	{
+		int interval = 1; // Every that many frames
+		int offscreenInterval = 1; // Same while the entity is outside the scene's screen rect, never more often than interval
+		float dormantDistance = 0.0f; // No updates at all that far from the screen rect, 0 to never sleep. Time asleep isn't passed on
+
+		bool isEveryFrame() const { return interval <= 1 && offscreenInterval <= 1 && dormantDistance <= 0.0f; }
+	};
+
+
 	class Component
 	{
 	public:
+		// Redefine to true when update() only touches the component's own state. It then runs on worker
+		// threads, where destroyEntity() is deferred and creating entities/components isn't allowed.
+		static const bool PARALLEL_UPDATE = false;
+
 		static void clearCachedEditorIcons();
 
 		Component();
+		Component(const Component& other); // A copy is a new component: own handle, no entity, not created yet
+		Component& operator=(const Component&) = delete;
 		virtual ~Component();
 
+		// Components update in the order they were created or last enabled, not in tree order.
+		// Don't count on a parent's components updating before its children's.
 		virtual void update(float deltaTime) {}
 		virtual void fixedUpdate(float deltaTime) {}
 		virtual void draw();
@@ -44,10 +66,10 @@ namespace Engine
 		virtual void onMouseUp() {} // Was up if previously downed inside (Not necessarly up inside!, Use onMouseClick for that)
 		virtual void onMouseClick() {} // Was Down and Up inside
 
-		virtual Json::Value serialize();
+		virtual Json::Value serialize(); // Can run on worker threads, only read our own state
 		virtual void deserialize(const Json::Value& json);
 
-		virtual std::string getType() const = 0;
+		virtual const std::string& getType() const = 0;
 		virtual std::string getEditName() const { return getType(); }
 		virtual TextureRef getEditorIcon() const;
 		virtual std::string getFriendlyName() const { return ""; }
@@ -58,20 +80,42 @@ namespace Engine
 		EntityRef getEntity();
 		Entity* getEntityRaw();
 		bool isEnabled() const { return m_isEnabled; }
+		ComponentTypeId getTypeId() const { return m_typeId; }
+		ComponentTypeId getNameId() const { return m_nameId; } // Same as type id, except scripts use their Lua component name
+		const ComponentHandle& getHandle() const { return m_handle; }
 		
 		void enable();
 		void disable();
+		void markChanged(); // Our entity goes in the next incremental save. Call it when changing what serialize() writes
+
+		const TickPolicy& getTickPolicy() const { return m_tickPolicy; }
+		void setTickPolicy(const TickPolicy& tickPolicy);
 		
 	public:
 		virtual bool edit() { return false; } // For editor, returns true if the Inspector modified a value
 
 	protected:
+		void setUpdatePhases(uint8_t phases); // For components that only know at runtime which phases they need
+
 		Entity* m_pEntity = nullptr;
+		ComponentTypeId m_nameId = INVALID_COMPONENT_TYPE;
 
 	private:
 		friend class Entity;
+		friend class ComponentManager;
+		friend class ComponentFactory;
+		friend class Scene;
 
+		ComponentHandle m_handle;
 		bool m_isEnabled = true;
+		ComponentTypeId m_typeId = INVALID_COMPONENT_TYPE;
+		bool m_isCreated = false; // Between onCreate and onDestroy. Pools also hold components that aren't in a scene yet
+		uint8_t m_updatePhases = 0; // Mask of (1 << UpdatePhase)
+		bool m_isDrawable = true; // Overrides draw, the factory clears it for types that don't
+		int m_updateListIndex[UPDATE_PHASE_COUNT] = { -1, -1, -1 }; // Our position in the component manager's update lists
+		TickPolicy m_tickPolicy;
+		float m_skippedTime = 0.0f; // Since our last update, while throttled
+		ComponentPool* m_pPool = nullptr; // The one we came from, to be recycled into
 
 		static std::unordered_map<std::string, TextureRef> cachedEditorIcons;
 	};
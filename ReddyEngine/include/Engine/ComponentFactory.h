@@ -1,8 +1,15 @@
 #pragma once
 
+#include "Engine/ComponentPool.h"
+
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <new>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 
@@ -13,6 +20,21 @@ namespace Engine
 
     using CreateComponentFn = ComponentRef(*)();
 
+    // Built-in component types get the first ids, in registration order. Lua component
+    // names are interned after them, so a name always maps to the same id.
+    using ComponentTypeId = uint32_t;
+    static const ComponentTypeId INVALID_COMPONENT_TYPE = 0xFFFFFFFF;
+
+    // Update passes a component takes part in, as a mask of (1 << phase). Built-ins get the ones
+    // they override, scripts narrow it down to the callbacks their Lua table defines.
+    enum UpdatePhase
+    {
+        UPDATE_PHASE_PARALLEL_UPDATE, // update() of types with PARALLEL_UPDATE, on worker threads before the others
+        UPDATE_PHASE_UPDATE,
+        UPDATE_PHASE_FIXED_UPDATE,
+        UPDATE_PHASE_COUNT
+    };
+
 
     class ComponentFactory
     {
@@ -21,21 +43,154 @@ namespace Engine
         static ComponentRef create(const std::string& name);
         static const std::vector<std::string>& getComponentNames();
 
+        template<typename T>
+        static ComponentTypeId getTypeId()
+        {
+            static const ComponentTypeId s_typeId = internName(T::getRegisterName());
+            return s_typeId;
+        }
+
+        static ComponentTypeId internName(const std::string& name); // Built-in type or Lua component name
+        static ComponentTypeId findTypeId(const std::string& name); // INVALID_COMPONENT_TYPE if it was never interned
+
+        // Allocates from T's pool, or hands back a recycled one. The shared_ptr gives the slot back
+        // when the last ref goes away.
+        template<typename T>
+        static std::shared_ptr<T> create()
+        {
+            static_assert(alignof(T) <= alignof(std::max_align_t), "Component alignment not supported by pools");
+
+            if (auto pRecycled = getPool<T>()->takeRecycled())
+                return std::static_pointer_cast<T>(pRecycled);
+
+            auto pComponent = construct<T>();
+            initComponent<T>(pComponent.get());
+            return pComponent;
+        }
+
+        // Copy of a component that isn't on an entity, like a prefab's. Same as deserializing
+        // it again, without the parsing. Null if its type can't be copied (scripts).
+        static ComponentRef clone(const ComponentRef& pPrototype);
+        static bool canClone(const ComponentRef& pComponent);
+
+        static CreateComponentFn getFactory(const std::string& name); // Null if unknown
+
+        // Hands a component only pComponent holds back to its pool, reset like a fresh one.
+        // Returns false (and leaves pComponent alone) if it's still referenced or its type can't be.
+        static bool recycle(ComponentRef& pComponent);
+        static void clearRecycled();
+
+        template<typename T>
+        static ComponentPool* getPool()
+        {
+            static ComponentPool* s_pPool = createPool(sizeof(T), [](void* pSlot) -> Component* { return static_cast<T*>(pSlot); }, getResetFn<T>(), getCloneFn<T>());
+            return s_pPool;
+        }
+
+        // In registration order
+        static const std::vector<std::unique_ptr<ComponentPool>>& getPools() { return s_pools; }
+
+        // Not overriding update/fixedUpdate means there's nothing to tick
+        template<typename T>
+        static uint8_t getUpdatePhases()
+        {
+            using UpdateFn = void (Component::*)(float);
+            return (std::is_same<decltype(&T::update), UpdateFn>::value ? 0 : 1 << (T::PARALLEL_UPDATE ? UPDATE_PHASE_PARALLEL_UPDATE : UPDATE_PHASE_UPDATE)) |
+                   (std::is_same<decltype(&T::fixedUpdate), UpdateFn>::value ? 0 : 1 << UPDATE_PHASE_FIXED_UPDATE);
+        }
+
     private:
         static bool registerFactory(const std::string& name, CreateComponentFn fn);
         template<typename T>
         static void registerComponent()
         {
-            registerFactory(T::getRegisterName(), []() -> std::shared_ptr<Component> { return std::make_shared<T>(); });
+            getTypeId<T>(); // So built-ins get the low ids, before any Lua name
+            getPool<T>(); // So pools are ordered like registration
+            registerFactory(T::getRegisterName(), []() -> std::shared_ptr<Component> { return create<T>(); });
+        }
+
+        template<typename T, typename... Args>
+        static std::shared_ptr<T> construct(Args&&... args)
+        {
+            auto pPool = getPool<T>();
+            auto pSlot = pPool->allocate();
+            auto pComponent = new (pSlot) T(std::forward<Args>(args)...);
+            pPool->setAlive(pSlot);
+
+            return std::shared_ptr<T>(pComponent, [pPool](T* pComponent)
+            {
+                pComponent->~T();
+                pPool->free(pComponent);
+            });
+        }
+
+        // Goes through T, Component is only declared here (its header includes ours)
+        template<typename T>
+        static void initComponent(T* pComponent)
+        {
+            pComponent->m_typeId = getTypeId<T>();
+            pComponent->m_nameId = pComponent->m_typeId;
+            pComponent->m_updatePhases = getUpdatePhases<T>();
+            pComponent->m_isDrawable = !std::is_same<decltype(&T::draw), void (Component::*)()>::value;
+            pComponent->m_pPool = getPool<T>();
+        }
+
+        // Constructing over a shared_from_this object would lose its weak ref, those aren't recycled
+        template<typename T>
+        static ComponentPool::ResetFn getResetFn()
+        {
+            if constexpr (std::is_base_of<std::enable_shared_from_this<T>, T>::value)
+            {
+                return nullptr;
+            }
+            else
+            {
+                return [](Component* pComponent)
+                {
+                    auto pTyped = static_cast<T*>(pComponent);
+                    pTyped->~T();
+                    new (pTyped) T();
+                    initComponent<T>(pTyped);
+                };
+            }
         }
 
+        // Scripts hold Lua state a copy can't share, they're the shared_from_this ones too
+        template<typename T>
+        static ComponentPool::CloneFn getCloneFn()
+        {
+            if constexpr (std::is_base_of<std::enable_shared_from_this<T>, T>::value || !std::is_copy_constructible<T>::value)
+            {
+                return nullptr;
+            }
+            else
+            {
+                return [](const Component* pPrototype) -> ComponentRef
+                {
+                    const auto& prototype = static_cast<const T&>(*pPrototype);
+                    if (auto pRecycled = getPool<T>()->takeRecycled())
+                    {
+                        auto pTyped = static_cast<T*>(pRecycled.get());
+                        pTyped->~T();
+                        new (pTyped) T(prototype);
+                        return pRecycled;
+                    }
+                    return construct<T>(prototype);
+                };
+            }
+        }
+
+        static ComponentPool* createPool(size_t stride, ComponentPool::ToComponentFn toComponent, ComponentPool::ResetFn reset, ComponentPool::CloneFn clone);
+
         static std::map<std::string, CreateComponentFn> s_factories;
         static std::vector<std::string> s_componentNames;
+        static std::vector<std::unique_ptr<ComponentPool>> s_pools;
+        static std::unordered_map<std::string, ComponentTypeId> s_typeIds;
     };
 }
 
 #define DECLARE_COMPONENT(name) \
 public: \
-    static std::string getRegisterName() { return name; } \
-	std::string getType() const override { return name; } \
+    static const std::string& getRegisterName() { static const std::string s_name = name; return s_name; } \
+	const std::string& getType() const override { return getRegisterName(); } \
 private:
@@ -0,0 +1,83 @@
+// Contiguous storage for every component of one type. Memory is split in fixed chunks so
+// components never move once created, and freed slots are reused by the next allocation.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace Engine
+{
+    class Component;
+
+
+    class ComponentPool final
+    {
+    public:
+        static const int CHUNK_SIZE = 256;
+
+        static const int MAX_RECYCLED = 1024; // Past that, dead components are freed like before
+
+        using ToComponentFn = Component*(*)(void*);
+        using ResetFn = void(*)(Component*); // Destructs and constructs again in place
+        using CloneFn = std::shared_ptr<Component>(*)(const Component*); // Copy constructs a new one from a prototype
+
+        ComponentPool(size_t stride, ToComponentFn toComponent, ResetFn reset = nullptr, CloneFn clone = nullptr);
+        ~ComponentPool();
+
+        void* allocate(); // Raw slot, construct in place
+        void free(void* pSlot); // Object must already be destructed
+
+        void setAlive(void* pSlot); // Call once constructed, so forEach sees it
+
+        // Visits live components in memory order. Safe to create/destroy components from fn,
+        // new ones may or may not be visited.
+        template<typename Fn>
+        void forEach(Fn fn)
+        {
+            for (size_t c = 0; c < m_chunks.size(); ++c)
+            {
+                auto pChunk = m_chunks[c].get();
+                for (int i = 0; i < pChunk->used; ++i)
+                {
+                    if (pChunk->alive[i])
+                        fn(m_toComponent(pChunk->pStorage + i * m_stride));
+                }
+            }
+        }
+
+        // Components nobody holds anymore, reset to fresh and kept with their shared_ptr, so the next
+        // create doesn't allocate anything. Types without a reset fn can't be recycled.
+        bool canRecycle() const { return m_reset != nullptr; }
+        bool recycle(std::shared_ptr<Component>& pComponent); // Takes it if it returns true
+        std::shared_ptr<Component> takeRecycled(); // Null if there's none
+        void clearRecycled();
+
+        CloneFn getCloneFn() const { return m_clone; } // Null if the type can't be copied
+
+        int getCount() const { return m_count; }
+        int getCapacity() const { return (int)m_chunks.size() * CHUNK_SIZE; }
+
+    private:
+        struct Chunk
+        {
+            uint8_t* pStorage = nullptr;
+            int used = 0; // High water mark, slots past it were never allocated
+            bool alive[CHUNK_SIZE] = {};
+        };
+
+        bool findSlot(void* pSlot, Chunk*& pChunk, int& index) const;
+
+        size_t m_stride;
+        ToComponentFn m_toComponent;
+        ResetFn m_reset;
+        CloneFn m_clone;
+        std::vector<std::unique_ptr<Chunk>> m_chunks;
+        std::vector<void*> m_freeSlots;
+        int m_count = 0;
+        std::vector<std::shared_ptr<Component>> m_recycled;
+    };
+}
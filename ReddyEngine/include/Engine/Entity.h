@@ -1,11 +1,17 @@
 #pragma once
 
+#include "Engine/ComponentFactory.h"
+#include "Engine/Handle.h"
+#include "Engine/Transform2D.h"
+
 #include <glm/vec2.hpp>
 #include <glm/mat4x4.hpp>
 #include <json/json.h>
 
 #include <string>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 
@@ -16,6 +22,7 @@ namespace Engine
 
 	class Entity;
 	using EntityRef = std::shared_ptr<Entity>;
+	using EntityHandle = Handle<Entity>;
 
 	class ScriptComponent;
 
@@ -43,6 +50,26 @@ namespace Engine
 		}
 	};
 
+	// An entity's own fields, without its components and children. Json, binary scenes and
+	// prefabs all go through this, so a new field only has to be added here.
+	struct SceneEntityRecord
+	{
+		int parent = -1; // Record index, -1 for the root
+		uint64_t id = 0;
+		std::string name;
+		Transform transform;
+		bool enabled = true;
+		bool sortChildren = false;
+		bool mouseChildren = true;
+		bool clickThrough = false;
+		bool uiRoot = false;
+		bool lockScale = true;
+		bool expanded = true;
+		bool editorVisible = true;
+		bool editorLocked = false;
+		int componentCount = 0;
+	};
+
 	struct EntitySearchParams
 	{
 		// 0 signifies no impact
@@ -56,7 +83,7 @@ namespace Engine
 	{
 	public:
 		uint64_t id = 0;
-		std::string name;
+		std::string name; // Read only, use setName() so the scene's name index follows
 		bool sortChildren = false;
 		bool mouseChildren = true;
 		bool clickThrough = false;
@@ -67,8 +94,12 @@ namespace Engine
 		Entity();
 		~Entity();
 
+		void setName(const std::string& newName);
+		void markChanged(); // For incremental saves. Setters do it, call it after changing the public fields directly
+
 		bool addChild(EntityRef pChild, int insertAt = -1); // True if was added, false if already child
-		bool removeChild(const EntityRef& pChild); // True if was removed
+		bool removeChild(const EntityRef& pChild); // True if was removed. Siblings after it shift down, use addChildren/Scene::destroyEntities for many
+		void addChildren(const std::vector<EntityRef>& children); // Reparents them all at the end, in order. Linear, every parent they leave is compacted once
 		EntityRef getParent() const { return m_pParent ? m_pParent->shared_from_this() : nullptr; }
 		const std::vector<EntityRef>& getChildren() const { return m_children; }
 		int getChildIndex(const EntityRef& pChild) const; // -1 if not child
@@ -81,32 +112,26 @@ namespace Engine
 		template<typename T>
 		bool hasComponent() const
 		{
-			for (const auto& pComponent : m_components)
-			{
-				auto pRet = std::dynamic_pointer_cast<T>(pComponent);
-				if (pRet) return true;
-			}
-			return false;
+			return hasComponentId(ComponentFactory::getTypeId<T>());
 		}
 
 		template<typename T>
 		std::shared_ptr<T> getComponent() const
 		{
-			for (const auto& pComponent : m_components)
-			{
-				auto pRet = std::dynamic_pointer_cast<T>(pComponent);
-				if (pRet) return pRet;
-			}
-			return nullptr;
+			return std::static_pointer_cast<T>(getComponentById(ComponentFactory::getTypeId<T>()));
 		}
 
+		bool hasComponentId(ComponentTypeId id) const;
+		ComponentRef getComponentById(ComponentTypeId id) const; // Type id, or a script's Lua component name id
+		ComponentRef getComponentByName(const std::string& name) const; // "Sprite", "Script", or a Lua component name
+
 		template<typename T>
 		std::shared_ptr<T> addComponent()
 		{
 			auto pComponent = getComponent<T>();
-			if (pComponent && !std::dynamic_pointer_cast<ScriptComponent>(pComponent)) return pComponent;
+			if (pComponent && !std::is_same<T, ScriptComponent>::value) return pComponent;
 
-			pComponent = std::make_shared<T>();
+			pComponent = ComponentFactory::create<T>();
 			
 			pComponent->m_pEntity = this;
 			m_components.push_back(pComponent);
@@ -118,16 +143,11 @@ namespace Engine
 		void addComponent(const ComponentRef& pComponent);
 
 		template<typename T>
-		bool removeComponent() const
+		bool removeComponent()
 		{
-			for (auto it = m_components.begin(); it != m_components.end(); ++it)
-			{
-				auto pComponent = std::dynamic_pointer_cast<T>(*it);
-				getScene()->getComponentManager()->removeComponent(pComponent);
-				m_components.erase(it);
-				return true;
-			}
-			return false;
+			auto pComponent = getComponent<T>();
+			if (!pComponent) return false;
+			return removeComponent(pComponent);
 		}
 
 		bool removeComponent(const ComponentRef& pComponent);
@@ -135,6 +155,12 @@ namespace Engine
 		Json::Value serialize(bool includeChildren = true);
 		void deserialize(const Json::Value json, bool includeChildren = true, bool generateNewIds = false);
 
+		// Parent is left alone, it's the caller's index
+		static void readRecord(const Json::Value& json, SceneEntityRecord& out);
+		static void writeRecord(const SceneEntityRecord& record, Json::Value& json); // Components and children aren't written
+		void getRecord(SceneEntityRecord& out) const;
+		void applyRecord(const SceneEntityRecord& record); // Everything but parent, id and components
+
 		EntityRef getChildByName(const std::string& name, bool recursive = false);
 		EntityRef getChildByName(const std::string& name, const EntitySearchParams &searchParams, bool recursive = false);
 		void findByName(const std::string& name, std::vector<EntityRef>& entities, bool recursive = false);
@@ -145,28 +171,16 @@ namespace Engine
 		EntityRef findByComponent(const std::string& componentName, const EntitySearchParams &searchParams, bool recursive = false);
 		void findByComponent(const std::string& componentName, std::vector<EntityRef>& entities, bool recursive = false);
 		void findByComponent(const std::string& componentName, std::vector<EntityRef>& entities, const EntitySearchParams &searchParams, bool recursive = false);
+		EntityRef findByComponent(ComponentTypeId typeId, const EntitySearchParams &searchParams, bool recursive = false);
+		void findByComponent(ComponentTypeId typeId, std::vector<EntityRef>& entities, const EntitySearchParams &searchParams, bool recursive = false);
 
 		bool hasChild(const EntityRef& pChild, bool recursive = false) const;
+		bool isDescendantOf(const Entity* pAncestor) const; // Walks up the parents, cheaper than hasChild(recursive)
 
 		template <class T>
 		EntityRef getChildByComponent(const EntitySearchParams& searchParams, bool recursive)
 		{
-			for (auto it = m_children.begin(); it != m_children.end(); ++it) {
-				const EntityRef &ref = *it;
-
-				if (ref->hasComponent<T>() && (searchParams.radius < FLT_EPSILON || ref->isInRadius(searchParams.pointInWorld, searchParams.radius)))
-				{
-					return ref;
-				}
-
-				if (recursive) {
-					if (auto found_child = ref->getChildByComponent<T>(searchParams, true)) {
-						return found_child;
-					}
-				}
-			}
-
-			return nullptr;
+			return getChildByComponentId(ComponentFactory::getTypeId<T>(), searchParams, recursive);
 		}
 
 		template <class T>
@@ -178,25 +192,17 @@ namespace Engine
 		template <class T>
 		void getChildrenByComponent(std::vector<EntityRef>& outRefs, const EntitySearchParams& searchParams, bool recursive = false)
 		{
-			for (auto it = m_children.begin(); it != m_children.end(); ++it) {
-				const EntityRef &ref = *it;
-
-				if (ref->hasComponent<T>() && (searchParams.radius < FLT_EPSILON || ref->isInRadius(searchParams.pointInWorld, searchParams.radius)))
-				{
-					outRefs.push_back(ref);
-				}
-
-				if (recursive) {
-					ref->getChildrenByComponent<T>(outRefs, searchParams, true);
-				}
-			}
+			getChildrenByComponentId(ComponentFactory::getTypeId<T>(), outRefs, searchParams, recursive);
 		}
 
 		template <class T>
 		void getChildrenByComponent(std::vector<EntityRef>& outRefs, bool recursive = false)
 		{
-			getChildrenByComponent(outRefs, EntitySearchParams { }, recursive);
+			getChildrenByComponent<T>(outRefs, EntitySearchParams { }, recursive);
 		}
+
+		EntityRef getChildByComponentId(ComponentTypeId typeId, const EntitySearchParams& searchParams, bool recursive = false);
+		void getChildrenByComponentId(ComponentTypeId typeId, std::vector<EntityRef>& outRefs, const EntitySearchParams& searchParams, bool recursive = false);
 		
 		// Oh boy this was dangerous.
 		//friend bool operator==(const Entity& lhs, const Entity& rhs)
@@ -204,7 +210,8 @@ namespace Engine
 		//	return lhs.id == rhs.id;
 		//}
 
-		void collectUpdatables(std::vector<ComponentRef>& updatables);
+		bool isEnabledInScene(const Entity* pRoot) const; // This and all parents enabled, and attached under pRoot
+		void componentNameChanged(); // A script component got renamed, refresh lookups
 		void draw();
 
 		const Transform& getTransform() const { return m_transform; }
@@ -220,10 +227,10 @@ namespace Engine
 		void setWorldPosition(const glm::vec2& position);
 		void setDirtyTransform();
 
-		const glm::mat4& getWorldTransform();
-		const glm::mat4& getWorldTransformWithScale();
-		const glm::mat4& getInvWorldTransform();
-		const glm::mat4& getInvWorldTransformWithScale();
+		const Transform2D& getWorldTransform();
+		const Transform2D& getWorldTransformWithScale();
+		const Transform2D& getInvWorldTransform();
+		const Transform2D& getInvWorldTransformWithScale();
 
 		bool isInRadius(const glm::vec2& pointInWorld, float radius, bool inclusive = true);
 
@@ -238,6 +245,8 @@ namespace Engine
 		void onMouseUp();
 		void onMouseClick();
 
+		const EntityHandle& getHandle() const { return m_handle; }
+
 		uint64_t runtimeId = 0; // This has nothing to do with entity Id. Its for Lua
 		std::string luaName;
 		bool enabled = true;
@@ -253,18 +262,71 @@ namespace Engine
 		bool editorLocked = false;
 
 	private:
+		static const int COMPONENT_INDEX_BITS = 64;
+		static const int PARALLEL_SERIALIZE_MIN_ENTITIES = 256;
+		static const int PARALLEL_SERIALIZE_BATCH_SIZE = 32; // Entities or components per job, when the scene (de)serializes in parallel
+
+		// Cached top to bottom order of our children, for sortChildren
+		struct SortedChild
+		{
+			Entity* pEntity;
+			float y;
+			uint32_t worldVersion; // Child's m_worldVersion when y was read
+		};
+
+		const std::vector<SortedChild>& getSortedChildren();
+		static bool isBeforeInTree(const Entity* pA, const Entity* pB);
+
+		Json::Value serializeSelf(bool includeChildren) const;
 		void componentAdded(const ComponentRef& pComponent);
+		void indexComponent(ComponentTypeId id, const ComponentRef& pComponent);
+		void rebuildComponentIndex();
+		void updateSceneComponentIndex();
+
+		friend class Scene;
+		void releaseFromScene(); // Out of the scene's tables, like we're dead
+		void resetForReuse(); // Back to how the constructor left us, minus the handle and Lua table
+		void reuse(); // Out of the scene's pool, registers again with a new Lua table
+		void reorderChildren(const Json::Value& ids, std::vector<EntityRef>& outUnlisted); // Children in the order of their ids
+		void childDetached(Entity* pChild); // Everything removeChild does, except taking it out of m_children
+		void removeDetachedChildren(); // The other half, for many at once
+		void reindexChildren(int from);
+
+		friend class SpatialGrid;
+		friend class TransformSystem;
 		void updateDirtyTransforms();
+		bool refreshWorldTransform(); // Returns true if it changed
+		void updateInverseTransforms();
+		void markSpatialDirty();
 		bool isMouseHover(const glm::vec2& mousePos) const;
 
-		bool m_transformDirty = true;
+		EntityHandle m_handle;
+		bool m_hasChanges = false; // Queued in the scene's changed list, since the last save
+		bool m_isSaved = false; // In the save game, its destruction needs saving too
+		bool m_transformDirty = true; // Local transform changed
+		bool m_inverseDirty = true; // Inverses are only computed when asked for
+		uint32_t m_worldVersion = 0; // Bumped every time our world transform is recomputed
+		uint32_t m_parentVersion = 0; // Parent's m_worldVersion we were computed from
+		uint32_t m_orderStamp = 0; // Matches the transform system's when we're in its flat order
 		Transform m_transform;
 		Entity* m_pParent = nullptr;
+		int m_childIndex = -1; // Our position in the parent's m_children
+		uint32_t m_drawBegin = 0; // Our components and children in the scene's draw list
+		uint32_t m_drawEnd = 0;
 		std::vector<EntityRef> m_children;
+		std::vector<SortedChild> m_sortedChildren;
+		bool m_sortedChildrenDirty = true; // Children added/removed
 		std::vector<ComponentRef> m_components;
-		glm::mat4 m_worldTransform;
-		glm::mat4 m_invWorldTransform;
-		glm::mat4 m_worldTransformWithScale;
-		glm::mat4 m_invWorldTransformWithScale; // For mouse pick
+		uint64_t m_componentMask = 0; // Bit per type/name id, for ids under COMPONENT_INDEX_BITS
+		std::vector<ComponentRef> m_indexedComponents; // First component of each id in m_componentMask, by id order
+		int m_sceneNameIndex = -1; // Our position in the scene's bucket for our name
+		std::vector<std::pair<ComponentTypeId, int>> m_sceneComponentIndex; // Our position in the scene's bucket for each component id
+		uint64_t m_spatialCell = 0; // Spatial grid cell we're in, and our position in it
+		int m_spatialIndex = -1;
+		bool m_spatialDirty = false; // Queued for the grid to re-read our position
+		Transform2D m_worldTransform;
+		Transform2D m_invWorldTransform;
+		Transform2D m_worldTransformWithScale;
+		Transform2D m_invWorldTransformWithScale; // For mouse pick
 	};
 }
\ No newline at end of file
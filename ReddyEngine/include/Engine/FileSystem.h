@@ -0,0 +1,51 @@
+// Virtual file layer. Files are looked up in mounted .rpak packs first, then on disk.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace Engine
+{
+    namespace FileSystem
+    {
+        // Content of a file. When the file is stored uncompressed in a mounted pack,
+        // pData points directly into the mapped pack and nothing is copied.
+        struct FileData
+        {
+            const uint8_t* pData = nullptr;
+            size_t size = 0;
+            std::vector<uint8_t> storage; // Only used when we had to decompress or read from disk
+
+            FileData() = default;
+            FileData(const FileData&) = delete;
+            FileData& operator=(const FileData&) = delete;
+            FileData(FileData&& other) noexcept;
+            FileData& operator=(FileData&& other) noexcept;
+        };
+
+        // Packs mounted last have priority
+        bool mountPack(const std::string& filename);
+        void unmountPacks();
+
+        bool readFile(const std::string& filename, FileData& out);
+        bool fileExists(const std::string& filename); // Pack or disk
+        std::vector<std::string> findAllFiles(const std::string& lookIn, const std::string& extension = "*"); // Pack and disk, deep search
+
+        // Extra files derived from a source file when packing, like texture thumbnails
+        struct CookedFile
+        {
+            std::string filename;
+            std::vector<uint8_t> data;
+        };
+        using CookFn = std::function<void(const std::string& filename, const FileData& data, std::vector<CookedFile>& outCookedFiles)>;
+
+        // Packs every file under folder into a single .rpak. Entries that compress well are LZ4 compressed.
+        bool buildPack(const std::string& folder, const std::string& packFilename, bool compress = true, const CookFn& cookFn = nullptr);
+
+        uint64_t hashPath(const std::string& filename); // FNV-1a of the normalized path (lower case, forward slashes)
+    }
+}
@@ -9,6 +9,7 @@
 #include <unordered_map>
 
 #include "Engine/Resource.h"
+#include "Engine/Transform2D.h"
 
 
 struct stbtt_fontinfo;
@@ -42,11 +43,12 @@ namespace Engine
                   const glm::vec2& align = {0.0f, 0.0f},
                   float justify = 0.0f);
 
-        //void draw(const std::string& text,
-        //          const glm::mat4& transform, 
-        //          const glm::vec4& color = {1, 1, 1, 1},
-        //          float scale = 1.0f,
-        //          const glm::vec2& align = {0.0f, 0.0f});
+        void draw(const std::string& text,
+                  const Transform2D& transform, // Follows the transform's rotation, scale is on top
+                  const glm::vec4& color = {1, 1, 1, 1},
+                  float scale = 1.0f,
+                  const glm::vec2& align = {0.0f, 0.0f},
+                  float justify = 0.0f);
 
         glm::vec2 measure(const std::string& text);
 
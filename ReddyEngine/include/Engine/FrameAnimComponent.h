@@ -20,6 +20,8 @@ namespace Engine
 		DECLARE_COMPONENT("FrameAnim");
 
     public:
+		static const bool PARALLEL_UPDATE = true; // Only advances our own timers
+
 		FrameAnimComponent();
 		FrameAnimComponent(const FrameAnimRef &frameAnim);
 		~FrameAnimComponent() {}
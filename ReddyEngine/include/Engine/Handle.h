@@ -0,0 +1,100 @@
+// Generational handles. A handle is a slot index plus the generation the slot had when the object
+// was added. Once the object is removed the slot's generation moves on, so old handles resolve
+// to nullptr instead of a dangling pointer, even after the slot gets reused.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+
+namespace Engine
+{
+    template<typename T>
+    struct Handle
+    {
+        static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+        uint32_t index = INVALID_INDEX;
+        uint32_t generation = 0;
+
+        bool isValid() const { return index != INVALID_INDEX; }
+
+        bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+
+        // Packed so Lua can hold it as light userdata. Generations start at 1, so it's never null.
+        void* toUserData() const
+        {
+            static_assert(sizeof(void*) >= sizeof(uint64_t), "Handles need 64 bits pointers to fit in light userdata");
+            return (void*)(uintptr_t)(((uint64_t)generation << 32) | index);
+        }
+
+        static Handle fromUserData(const void* pUserData)
+        {
+            auto packed = (uint64_t)(uintptr_t)pUserData;
+            Handle handle;
+            handle.index = (uint32_t)(packed & 0xFFFFFFFF);
+            handle.generation = (uint32_t)(packed >> 32);
+            return handle;
+        }
+    };
+
+
+    template<typename T>
+    class SlotTable final
+    {
+    public:
+        Handle<T> add(T* pObject)
+        {
+            uint32_t index;
+            if (!m_freeSlots.empty())
+            {
+                index = m_freeSlots.back();
+                m_freeSlots.pop_back();
+            }
+            else
+            {
+                index = (uint32_t)m_slots.size();
+                m_slots.push_back({});
+            }
+
+            auto& slot = m_slots[index];
+            slot.pObject = pObject;
+
+            Handle<T> handle;
+            handle.index = index;
+            handle.generation = slot.generation;
+            return handle;
+        }
+
+        void remove(const Handle<T>& handle)
+        {
+            if (!get(handle)) return;
+
+            auto& slot = m_slots[handle.index];
+            slot.pObject = nullptr;
+            if (++slot.generation == 0) slot.generation = 1; // 0 is never a live generation
+            m_freeSlots.push_back(handle.index);
+        }
+
+        T* get(const Handle<T>& handle) const
+        {
+            if (handle.index >= (uint32_t)m_slots.size()) return nullptr;
+            const auto& slot = m_slots[handle.index];
+            return slot.generation == handle.generation ? slot.pObject : nullptr;
+        }
+
+        int size() const { return (int)(m_slots.size() - m_freeSlots.size()); }
+
+    private:
+        struct Slot
+        {
+            T* pObject = nullptr;
+            uint32_t generation = 1;
+        };
+
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_freeSlots;
+    };
+}
@@ -0,0 +1,62 @@
+// Small pool of worker threads. Anything touching GL, Lua or the scene graph stays on the main thread.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Engine
+{
+    class JobSystem;
+    using JobSystemRef = std::shared_ptr<JobSystem>;
+
+
+    // Number of jobs still running. Pass it to schedule() and wait() on it.
+    struct JobCounter
+    {
+        std::atomic<int> pending{ 0 };
+
+        bool isDone() const { return pending.load() == 0; }
+    };
+
+
+    class JobSystem final
+    {
+    public:
+        using Job = std::function<void()>;
+
+        JobSystem(int workerCount = -1); // -1 = one per core, minus the main thread
+        ~JobSystem();
+
+        void schedule(const Job& job, JobCounter* pCounter = nullptr);
+        void wait(JobCounter& counter); // The waiting thread helps with the queue instead of sleeping
+
+        // Calls fn(i) for every i in [0, count), split in batches of batchSize. Blocks until they are all done.
+        void parallelFor(int count, const std::function<void(int)>& fn, int batchSize = 1);
+
+        int getWorkerCount() const { return (int)m_workers.size(); }
+
+    private:
+        struct QueuedJob
+        {
+            Job job;
+            JobCounter* pCounter;
+        };
+
+        void workerLoop();
+        bool runOneJob();
+
+        std::vector<std::thread> m_workers;
+        std::deque<QueuedJob> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stop = false;
+    };
+}
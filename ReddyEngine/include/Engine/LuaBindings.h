@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Engine/IGame.h>
+#include <Engine/ResourceId.h>
 
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
@@ -26,6 +27,9 @@ namespace Engine
     class Entity;
     using EntityRef = std::shared_ptr<Entity>;
 
+    class Prefab;
+    using PrefabRef = std::shared_ptr<Prefab>;
+
     class IEvent;
     class KeyDownEvent;
     class KeyUpEvent;
@@ -100,6 +104,7 @@ namespace Engine
         int funcGetParent(lua_State* L);
         int funcAddChild(lua_State* L);
         int funcCreateEntity(lua_State* L);
+        int funcCreateEntities(lua_State* L);
         int funcDestroy(lua_State* L);
         int funcAddComponent(lua_State* L);
         int funcRemoveComponent(lua_State* L);
@@ -153,6 +158,7 @@ namespace Engine
 
         int funcFindEntitiesByName(lua_State* L);
         int funcFindEntitiesByComponent(lua_State* L);
+        int funcFindEntitiesWithComponents(lua_State* L);
 
         int funcContinueGame(lua_State* L);
         int funcNewGame(lua_State* L);
@@ -178,6 +184,7 @@ namespace Engine
         int funcDisableEntity(lua_State* L);
         int funcEnableComponent(lua_State* L);
         int funcDisableComponent(lua_State* L);
+        int funcSetTickPolicy(lua_State* L);
 
         int funcGetConfig(lua_State* L);
         int funcSetConfig(lua_State* L);
@@ -192,6 +199,7 @@ namespace Engine
         ScriptComponentRef getScriptComponentFromListener(void* listener, std::string name, std::string* callbackName);
 
         void createBindings();
+        PrefabRef getPrefab(const std::string& filename); // Loaded and compiled the first time, null if it fails
 
         void onKeyDown(IEvent* pEvent);
         void onKeyUp(IEvent* pEvent);
@@ -201,7 +209,7 @@ namespace Engine
 
         lua_State* L = nullptr;
 
-        std::unordered_map<std::string, Json::Value> m_prefabCache;
+        std::unordered_map<std::string, PrefabRef> m_prefabCache;
         std::map<std::string, LuaComponentDef*> m_componentDefs;
         LuaComponentDef* m_pCurrentComponentDef = nullptr;
         StateChangeRequest m_stateChangeRequest = StateChangeRequest::None;
@@ -221,7 +229,9 @@ namespace Engine
 #define LUA_GET_VEC2(i, defaultValue) LUA_GET_VEC2_impl(L, i, defaultValue)
 #define LUA_GET_COLOR(i, defaultValue) LUA_GET_COLOR_impl(L, i, defaultValue)
 #define LUA_GET_STRING(i, defaultValue) LUA_GET_STRING_impl(L, i, defaultValue)
+#define LUA_GET_RESOURCE_ID(i, defaultValue) LUA_GET_RESOURCE_ID_impl(L, i, defaultValue) // Only valid while the string is on the stack
 #define LUA_GET_ENTITY(i) LUA_GET_ENTITY_impl(L, i, __func__)
+#define LUA_GET_ENTITY_RAW(i) LUA_GET_ENTITY_RAW_impl(L, i, __func__) // No refcounting, only valid during the call
 #define LUA_GET_COMPONENT(i, component) LUA_GET_COMPONENT_impl<component>(L, i, __func__)
 
 #define LUA_GET_SCRIPT_COMPONENT(i) LUA_GET_SCRIPT_COMPONENT_impl(L, i, __func__)
@@ -235,11 +245,13 @@ float LUA_GET_NUMBER_impl(lua_State* L, int stackIndex, float defaultValue);
 glm::vec2 LUA_GET_VEC2_impl(lua_State* L, int stackIndex, const glm::vec2& defaultValue);
 glm::vec4 LUA_GET_COLOR_impl(lua_State* L, int stackIndex, const glm::vec4& defaultValue);
 std::string LUA_GET_STRING_impl(lua_State* L, int stackIndex, const std::string& defaultValue);
+Engine::ResourceId LUA_GET_RESOURCE_ID_impl(lua_State* L, int stackIndex, const Engine::ResourceId& defaultValue);
 Engine::EntityRef LUA_GET_ENTITY_impl(lua_State* L, int stackIndex, const char* funcName);
+Engine::Entity* LUA_GET_ENTITY_RAW_impl(lua_State* L, int stackIndex, const char* funcName);
 template<typename T>
 std::shared_ptr<T> LUA_GET_COMPONENT_impl(lua_State* L, int stackIndex, const char* funcName)
 {
-    auto pEntity = LUA_GET_ENTITY(stackIndex);
+    auto pEntity = LUA_GET_ENTITY_RAW(stackIndex);
     if (pEntity) return pEntity->getComponent<T>();
     return nullptr;
 }
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <Engine/Audio.h>
+#include "Engine/FileSystem.h"
 #include "Engine/Resource.h"
 
 #include <atomic>
@@ -68,6 +69,7 @@ namespace Engine
         int m_bufferMax = 0;
         int m_engineChannelCount = 44100;
         std::string m_filename;
+        FileSystem::FileData m_fileData; // Vorbis decodes from this while playing
         stb_vorbis* m_pStream = nullptr;
     };
 }
@@ -4,6 +4,7 @@
 #include <glm/vec4.hpp>
 #include <json/json.h>
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <memory>
 #include <string>
@@ -29,6 +30,26 @@ namespace Engine
     };
 
 
+    // Xorshift, one per instance. rand() is shared and locked (or per thread and never seeded)
+    // when instances update on worker threads.
+    class PFXRandom final
+    {
+    public:
+        PFXRandom(uint32_t seed) : m_state(seed ? seed : 1) {}
+
+        float next() // [0, 1]
+        {
+            m_state ^= m_state << 13;
+            m_state ^= m_state >> 17;
+            m_state ^= m_state << 5;
+            return (float)(m_state % 10001) / 10000.0f;
+        }
+
+    private:
+        uint32_t m_state;
+    };
+
+
     template<typename T>
     class RangedPFXValue final
     {
@@ -73,18 +94,18 @@ namespace Engine
             endRange[1] = Utils::deserializeJsonValue<T>(json["endRange"][1]);
         }
 
-        T genStart() const
+        T genStart(PFXRandom& rng) const
         {
             if (!randomStart) return startRange[0];
-            float p = (float)(rand() % 10001) / 10000.0f;
+            float p = rng.next();
             return startRange[0] + (startRange[1] - startRange[0]) * p;
         }
 
-        T genEnd(const T& startValue) const
+        T genEnd(const T& startValue, PFXRandom& rng) const
         {
             if (sameStartEnd) return startValue;
             if (!randomEnd) return endRange[0];
-            float p = (float)(rand() % 10001) / 10000.0f;
+            float p = rng.next();
             return endRange[0] + (endRange[1] - endRange[0]) * p;
         }
     };
@@ -119,10 +140,10 @@ namespace Engine
             range[1] = Utils::deserializeJsonValue<T>(json["range"][1]);
         }
 
-        T gen() const
+        T gen(PFXRandom& rng) const
         {
             if (!random) return range[0];
-            float p = (float)(rand() % 10001) / 10000.0f;
+            float p = rng.next();
             return range[0] + (range[1] - range[0]) * p;
         }
     };
@@ -221,5 +242,6 @@ namespace Engine
         int m_nextFromPool = 0;
         int m_poolSize = 0;
         Particle* m_pParticleHead = nullptr;
+        PFXRandom m_random;
     };
 }
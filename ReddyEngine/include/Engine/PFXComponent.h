@@ -20,6 +20,8 @@ namespace Engine
 		DECLARE_COMPONENT("PFX");
 
     public:
+		static const bool PARALLEL_UPDATE = true; // Only steps our own particles
+
 		PFXComponent();
 		~PFXComponent() {}
 
@@ -0,0 +1,56 @@
+// Entity tree compiled once from its json, for spawning lots of copies. Entities are flattened
+// parent before child, and components are kept as deserialized prototypes (resources already
+// loaded) that each instance copy constructs. Scripts can't be copied, they keep their json.
+
+#pragma once
+
+#include "Engine/ComponentFactory.h"
+#include "Engine/Entity.h"
+
+#include <json/json.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace Engine
+{
+    class Prefab;
+    using PrefabRef = std::shared_ptr<Prefab>;
+
+
+    class Prefab final
+    {
+    public:
+        // json is an entity as Entity::serialize writes it (a prefab file's "root")
+        static PrefabRef compile(const Json::Value& json);
+
+        // Instances get new ids. Returns the instance's root.
+        EntityRef instantiate(const EntityRef& pParent) const;
+        void instantiate(const EntityRef& pParent, int count, std::vector<EntityRef>& outEntities) const;
+
+        int getEntityCount() const { return (int)m_entities.size(); }
+
+    private:
+        struct EntityRecord
+        {
+            SceneEntityRecord entity; // parent is an index in m_entities, -1 for the root
+            int componentBegin; // Range in m_components
+            int componentEnd;
+        };
+
+        struct ComponentRecord
+        {
+            ComponentRef pPrototype; // Null when it can't be copied
+            CreateComponentFn create; // Otherwise, created and deserialized from json every time
+            Json::Value json;
+        };
+
+        void compileEntity(const Json::Value& json, int parent);
+        EntityRef instantiateEntity(const EntityRecord& record, const EntityRef& pParent) const;
+
+        std::vector<EntityRecord> m_entities;
+        std::vector<ComponentRecord> m_components;
+    };
+}
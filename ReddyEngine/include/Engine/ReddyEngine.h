@@ -41,6 +41,9 @@ namespace Engine
     class MusicManager;
     using MusicManagerRef = std::shared_ptr<MusicManager>;
 
+    class JobSystem;
+    using JobSystemRef = std::shared_ptr<JobSystem>;
+
     
     const IGameRef& getGame();
     const SpriteBatchRef& getSpriteBatch();
@@ -51,6 +54,7 @@ namespace Engine
 	const EventSystemRef& getEventSystem();
 	const LuaBindingsRef& getLuaBindings();
     const MusicManagerRef& getMusicManager();
+    const JobSystemRef& getJobSystem();
 
 
     void Run(const std::shared_ptr<IGame>& pGame, int argc, const char** argv);
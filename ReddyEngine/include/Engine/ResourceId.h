@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace Engine
+{
+    static constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    // FNV-1a, case insensitive and '\' == '/'. Repeated slashes count as one.
+    constexpr uint64_t hashPathChars(const char* str, size_t len, uint64_t seed = FNV_OFFSET)
+    {
+        uint64_t h = seed;
+        char prev = 0;
+        for (size_t i = 0; i < len; ++i)
+        {
+            char c = str[i];
+            if (c == '\\') c = '/';
+            if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+            if (c == '/' && prev == '/') continue;
+            prev = c;
+            h ^= (uint8_t)c;
+            h *= FNV_PRIME;
+        }
+        return h;
+    }
+
+    // Plain FNV-1a over the bytes, for content (cooked scenes and manifests checking their source json)
+    inline uint64_t hashBytes(const void* pData, size_t size, uint64_t seed = FNV_OFFSET)
+    {
+        uint64_t h = seed;
+        auto pBytes = (const uint8_t*)pData;
+        for (size_t i = 0; i < size; ++i)
+        {
+            h ^= pBytes[i];
+            h *= FNV_PRIME;
+        }
+        return h;
+    }
+
+    constexpr size_t constexprStrlen(const char* str)
+    {
+        size_t len = 0;
+        while (str[len]) ++len;
+        return len;
+    }
+
+    static constexpr uint64_t ASSETS_PATH_SEED = hashPathChars("assets/", 7);
+
+
+    // Interned resource name, relative to the assets folder ("textures/foo.png").
+    // The hash is computed once, at compile time for literals, so lookups are a single integer probe.
+    // It's the same hash the .rpak index uses for "assets/" + name.
+    class ResourceId
+    {
+    public:
+        constexpr ResourceId() = default;
+
+        // Keeps the pointer, meant for literals. Use the std::string version for anything that doesn't outlive the id.
+        constexpr ResourceId(const char* name)
+            : m_hash(hashPathChars(name, constexprStrlen(name), ASSETS_PATH_SEED))
+            , m_pName(name)
+        {
+        }
+
+        ResourceId(const std::string& name); // Interns the name
+
+        constexpr uint64_t getHash() const { return m_hash; }
+        const char* getName() const { return m_pName ? m_pName : ""; }
+        constexpr bool isValid() const { return m_pName != nullptr; }
+
+        constexpr bool operator==(const ResourceId& other) const { return m_hash == other.m_hash; }
+        constexpr bool operator!=(const ResourceId& other) const { return m_hash != other.m_hash; }
+
+    private:
+        uint64_t m_hash = 0;
+        const char* m_pName = nullptr;
+    };
+
+
+    struct ResourceIdHasher
+    {
+        size_t operator()(const ResourceId& id) const { return (size_t)id.getHash(); }
+    };
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include "Engine/AssetManifest.h"
 #include "Engine/Utils.h"
 #include "Engine/Sound.h"
 #include "Engine/Music.h"
@@ -6,6 +7,7 @@
 #include "Engine/Font.h"
 #include "Engine/PFX.h"
 #include "Engine/Resource.h"
+#include "Engine/ResourceId.h"
 #include "Engine/FrameAnim.h"
 #include <string>
 #include <unordered_map>
@@ -15,12 +17,15 @@ namespace Engine
     class ResourceManager
     {
     public:
-        SoundRef getSound(const std::string& name);
-        MusicRef getMusic(const std::string& name);
-        TextureRef getTexture(const std::string& name);
-        PFXRef getPFX(const std::string& name);
-        FontRef getFont(const std::string& name);
-        FrameAnimRef getFrameAnim(const std::string& name);
+        SoundRef getSound(const ResourceId& id);
+        MusicRef getMusic(const ResourceId& id);
+        TextureRef getTexture(const ResourceId& id);
+        PFXRef getPFX(const ResourceId& id);
+        FontRef getFont(const ResourceId& id);
+        FrameAnimRef getFrameAnim(const ResourceId& id);
+
+        // Loads everything in the manifest now. Textures are read and decoded in parallel on the job system.
+        void preload(const AssetManifest& manifest);
 
         /*! \brief Copy the file from \ref{path} to the assets directory, with \ref{subDir} 
             being one of textures, fonts, etc. to copy to. resultPath gets set to the resulting path
@@ -29,28 +34,31 @@ namespace Engine
         bool copyFileToAssets(const std::string& path, const std::string& subDir, std::string& resultPath);
 
     private:
-        std::unordered_map<std::string, ResourceRef> loadedResources;
+        template<typename Tresource>
+        using ResourceTable = std::unordered_map<ResourceId, std::shared_ptr<Tresource>, ResourceIdHasher>;
+
+        ResourceTable<Sound> m_sounds;
+        ResourceTable<Music> m_musics;
+        ResourceTable<Texture> m_textures;
+        ResourceTable<PFX> m_pfxs;
+        ResourceTable<Font> m_fonts;
+        ResourceTable<FrameAnim> m_frameAnims;
 
-        template<typename Tresouce, typename... Types>
-        std::shared_ptr<Tresouce> getResource(std::string name, Types... args)
+        template<typename Tresource>
+        std::shared_ptr<Tresource> getResource(ResourceTable<Tresource>& table, const ResourceId& id)
         {
-            auto filename = name;
-            name = "assets/" + name;
-            auto it = loadedResources.find(name);
-            if (it == loadedResources.end())
-            {
-                std::shared_ptr<Tresouce> pRet = Tresouce::createFromFile(name, args...);
-                if (pRet)
-                {
-                    pRet->setFilename(filename);
-                    loadedResources[name] = pRet;
-                }
-                return pRet;
-            }
-            else
+            auto it = table.find(id);
+            if (it != table.end()) return it->second;
+
+            // Only pay for the string on first load
+            std::string filename = id.getName();
+            std::shared_ptr<Tresource> pRet = Tresource::createFromFile("assets/" + filename);
+            if (pRet)
             {
-                return std::dynamic_pointer_cast<Tresouce>(it->second);
+                pRet->setFilename(filename);
+                table[ResourceId(filename)] = pRet; // Interned, id might point to a temporary string
             }
+            return pRet;
         }
     };
 }
@@ -0,0 +1,67 @@
+// Incremental save games. The first save and every compaction write the whole scene as a binary
+// base, the saves in between only append the entities that changed to a log next to it. Files are
+// written by a job from a snapshot taken on the main thread, so saving never waits on the disk.
+
+#pragma once
+
+#include "Engine/JobSystem.h"
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace Engine
+{
+    class SaveGame;
+    using SaveGameRef = std::shared_ptr<SaveGame>;
+
+
+    class SaveGame final
+    {
+    public:
+        static const int COMPACT_EVERY = 20; // Log entries before it's folded back into the base
+
+        SaveGame(const std::string& filename); // "world.json" saves to world.rscene, with world.rdelta as the log
+        ~SaveGame(); // Waits for the files to be written
+
+        // Call once the scene is loaded, with the extras of the binary scene it came from. If that
+        // was this save's base, the log is replayed over it. Otherwise it's a new game, saved right away.
+        void begin(const Json::Value& sceneExtras);
+
+        void save(); // Only what changed since the last save
+        void compact(); // Everything, and the log starts over
+        void update(); // Starts queued writes and reports failed ones, every frame
+        void flush(); // Blocks until everything is on disk
+
+    private:
+        // Immutable once queued, the job owns it
+        struct Write
+        {
+            std::vector<uint8_t> base; // Either a whole new base
+            Json::Value changes; // Or a log entry
+            bool failed = false;
+        };
+        using WriteRef = std::shared_ptr<Write>;
+
+        static bool writeFiles(const Write& write, const std::string& baseFilename, const std::string& logFilename);
+
+        bool replayLog(); // False if the log is damaged
+        void queue(const WriteRef& pWrite);
+        void writeFailed();
+
+        std::string m_baseFilename;
+        std::string m_logFilename;
+        uint64_t m_generation = 0; // Of the base, log entries from older bases are ignored
+        int m_logEntryCount = 0;
+        bool m_isRewriteNeeded = false; // A write failed, the next save compacts
+        Json::Value m_sceneExtras; // Without "save"
+        std::deque<WriteRef> m_writes; // The front one is being written when m_isWriting
+        bool m_isWriting = false;
+        JobCounter m_counter;
+    };
+}
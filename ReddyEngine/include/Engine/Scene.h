@@ -1,10 +1,14 @@
 #pragma once
 
+#include "Engine/ComponentFactory.h"
+#include "Engine/Handle.h"
+
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 #include <json/json.h>
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 
@@ -13,8 +17,18 @@ namespace Engine
 	class ComponentManager;
 	using ComponentManagerRef = std::shared_ptr<ComponentManager>;
 
+	class SpatialGrid;
+	using SpatialGridRef = std::shared_ptr<SpatialGrid>;
+
+	class TransformSystem;
+	using TransformSystemRef = std::shared_ptr<TransformSystem>;
+
 	class Entity;
 	using EntityRef = std::shared_ptr<Entity>;
+	using EntityHandle = Handle<Entity>;
+
+	class Component;
+	using ComponentHandle = Handle<Component>;
 
 	struct EntitySearchParams;
 
@@ -38,9 +52,16 @@ namespace Engine
 		EntityRef createEntityFromJson(const EntityRef& pParent, const Json::Value& json, bool generateNewIds = false);
 		void destroyEntity(EntityRef pEntity);
 		void destroyEntity(uint64_t id);
+		void destroyEntities(const std::vector<EntityRef>& entities); // Linear, every parent is compacted once. No duplicates
 
 		EntityRef findEntity(const EntityRef& pEntity, uint64_t id);
-		EntityRef findEntity(uint64_t id);
+		EntityRef findEntity(uint64_t id); // Constant time, through the id index
+
+		bool checkEntityIndex() const; // Debug, compares the id/name/component indexes against the whole tree. Logs and returns false on mismatch
+
+		// nullptr once the entity/component is destroyed
+		Entity* getEntity(const EntityHandle& handle) const { return m_entitySlots.get(handle); }
+		Component* getComponent(const ComponentHandle& handle) const { return m_componentSlots.get(handle); }
 
 		/*! \brief Search the root for an entity with the given name */
 		EntityRef getEntityByName(const std::string& name, bool recursive = false) const;
@@ -59,6 +80,18 @@ namespace Engine
 	    Json::Value serialize();
         void deserialize(const Json::Value& json);
 
+		// Same as above in the SceneBinary format. extras is stored as is (asset manifest, ...)
+		void serializeBinary(std::vector<uint8_t>& out, const Json::Value& extras = Json::Value());
+		bool deserializeBinary(const uint8_t* pData, size_t size); // Scene is left untouched if the data is corrupted
+
+		// Change tracking, for incremental saves. Once started, everything in the scene counts as
+		// saved, and entities that change are collected until takeChanges(). Changed entities are
+		// written alone (no children) with their parent id and child order. clear() stops it.
+		void trackChanges(); // Starts over when already tracking, after a full save
+		bool isTrackingChanges() const { return m_isTrackingChanges; }
+		Json::Value takeChanges(); // { "entities": [...], "destroyed": [ids] }, null if nothing changed
+		void applyChanges(const Json::Value& changes);
+
 		void update(float dt);
 		void fixedUpdate(float dt);
 		void draw();
@@ -69,7 +102,7 @@ namespace Engine
 		const glm::vec4& getScreenRect() const { return m_screenRect; }
 		void setScreenRect(const glm::vec4& screenRect) { m_screenRect = screenRect; } // In World coordinates
 
-		const EntityRef& getHoveredEntity() const { return m_pMouseHoverEntity; }
+		EntityRef getHoveredEntity() const;
 
 		uint64_t generateEntityId() { return ++m_id; }
 		void updateMaxId(uint64_t id) { m_id = std::max(m_id, id + 1); } // Such hacks
@@ -80,17 +113,98 @@ namespace Engine
 	public:
 		// Engine use only
 		const ComponentManagerRef& getComponentManager() const;
+		const SpatialGridRef& getSpatialGrid() const { return m_pSpatialGrid; } // World positions of every entity, for radius/rect queries
+		const TransformSystemRef& getTransformSystem() const { return m_pTransformSystem; }
+		EntityHandle registerEntity(Entity* pEntity) { return m_entitySlots.add(pEntity); }
+		void unregisterEntity(const EntityHandle& handle) { m_entitySlots.remove(handle); }
+		ComponentHandle registerComponent(Component* pComponent) { return m_componentSlots.add(pComponent); }
+		void unregisterComponent(const ComponentHandle& handle) { m_componentSlots.remove(handle); }
+		void indexEntity(Entity* pEntity, uint64_t previousId); // Call when pEntity->id changes
+		void unindexEntity(Entity* pEntity);
+		void indexEntityName(Entity* pEntity);
+		void unindexEntityName(Entity* pEntity);
+		void indexEntityComponent(Entity* pEntity, ComponentTypeId typeId);
+		void unindexEntityComponent(Entity* pEntity, ComponentTypeId typeId);
+		void entityChanged(Entity* pEntity); // Queues it for takeChanges()
+
+		// Every entity with that name/component, in no particular order. Includes detached ones, filter with isDescendantOf()
+		const std::vector<Entity*>& getEntitiesByName(const std::string& name) const;
+		const std::vector<Entity*>& getEntitiesByComponent(ComponentTypeId typeId) const;
+
+		// Entities attached under root that have all of Ts, like view<SpriteComponent, FrameAnimComponent>().
+		// The matches are cached per combination, and only rebuilt after one of its types was added/removed
+		// somewhere or an entity holding one was attached/detached. Don't do either while iterating.
+		template<typename... Ts>
+		const std::vector<Entity*>& view()
+		{
+			const ComponentTypeId typeIds[] = { ComponentFactory::getTypeId<Ts>()... };
+			return view(typeIds, (int)sizeof...(Ts));
+		}
+		const std::vector<Entity*>& view(const ComponentTypeId* pTypeIds, int count); // Type ids, or script name ids
+		void entityMoved(Entity* pEntity); // Attached or detached, views holding its subtree's types are rebuilt
+		void invalidateDrawList() { m_drawListDirty = true; } // An entity's components or children changed
 
 	private:
+		// Destroyed entities are reset and kept, with their components, so spawning mostly doesn't
+		// allocate once the pool is warm. Their Lua table is dropped like a dead entity's, a reused
+		// one gets a new table.
+		static const int MAX_POOLED_ENTITIES = 4096;
+
+		EntityRef allocateEntity();
+		void destroyDetachedEntity(const EntityRef& pEntity);
+		void recycleDestroyedEntities();
+		void recycleEntity(EntityRef pEntity);
+
+		static const int PARALLEL_MIN_COMPONENTS = 256; // Smaller scenes are saved/loaded on the main thread
+
+		void serializeComponents(const std::vector<Component*>& components, std::vector<Json::Value>& outJsons);
+
+		struct ComponentView
+		{
+			std::vector<ComponentTypeId> typeIds; // Sorted
+			std::vector<Entity*> entities;
+			bool dirty = true;
+		};
+
+		void invalidateViews(ComponentTypeId typeId);
+
+		// Game scenes draw from a flat list in paint order, only rebuilt when the hierarchy or an
+		// entity's components change. Enabled flags and sortChildren are checked as it's drawn, an
+		// entity's children are a group item whose children's ranges are drawn in the current order.
+		struct DrawItem
+		{
+			Component* pComponent; // Null for group items
+			Entity* pEntity; // Parent of the group
+			uint32_t end; // First item after the group
+		};
+
+		void rebuildDrawList();
+		void appendDrawItems(Entity* pEntity);
+		void drawItems(uint32_t begin, uint32_t end);
+
 		bool m_isEditorScene = false;
 		bool m_isMouseDown = false;
 		glm::vec2 m_mousePos = glm::vec2(0.0f); // In World coordinates
 		glm::vec4 m_screenRect = glm::vec4(0.0f); // In World coordinates
 		EntityRef m_pRoot;
-		EntityRef m_pMouseHoverEntity;
-		EntityRef m_pMouseDownEntity;
+		EntityHandle m_mouseHoverEntity;
+		EntityHandle m_mouseDownEntity;
 		uint64_t m_id = 0;
 		ComponentManagerRef m_pComponentManager;
+		SpatialGridRef m_pSpatialGrid;
+		TransformSystemRef m_pTransformSystem;
 		std::vector<EntityRef> m_entitiesToDestroy;
+		std::vector<EntityRef> m_entityPool;
+		bool m_isTrackingChanges = false;
+		std::vector<EntityHandle> m_changedEntities;
+		std::vector<uint64_t> m_destroyedIds; // Saved entities destroyed since the last takeChanges()
+		std::unordered_map<uint64_t, Entity*> m_entitiesById; // Can hold detached entities, findEntity checks they're still under root
+		std::unordered_map<std::string, std::vector<Entity*>> m_entitiesByName;
+		std::unordered_map<ComponentTypeId, std::vector<Entity*>> m_entitiesByComponent; // Type ids and script name ids
+		std::vector<std::unique_ptr<ComponentView>> m_componentViews; // Pointers, views are handed out by reference
+		std::vector<DrawItem> m_drawList;
+		bool m_drawListDirty = true;
+		SlotTable<Entity> m_entitySlots;
+		SlotTable<Component> m_componentSlots;
 	};
 }
@@ -0,0 +1,128 @@
+// Versioned binary scenes, cooked from the json ones which stay the editable source of truth.
+// Layout: header, string table, extras, then entity records parent before child, each followed
+// by its component blobs. Every string (names, keys, resource paths) is stored once in the string
+// table, everything else refers to it by index. Components still go through their json
+// deserialize, but their values come out of the blob without any text parsing.
+
+#pragma once
+
+#include "Engine/Entity.h"
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace Engine
+{
+    namespace SceneBinary
+    {
+        static const uint32_t MAGIC = 0x4E435352; // "RSCN"
+        static const uint32_t VERSION = 1;
+
+        std::string getBinaryFilename(const std::string& jsonFilename); // "scenes/foo.json" -> "scenes/foo.rscene"
+        bool isBinary(const uint8_t* pData, size_t size);
+        uint64_t getSourceHash(const uint8_t* pData, size_t size); // Hash of the json it was cooked from, 0 if it wasn't
+
+        // Converters. Extra top level keys of the scene json (camera, ...) are kept.
+        bool fromJson(const Json::Value& sceneJson, std::vector<uint8_t>& out, uint64_t sourceHash = 0);
+        bool toJson(const uint8_t* pData, size_t size, Json::Value& out);
+        bool cook(const uint8_t* pJsonData, size_t size, std::vector<uint8_t>& out); // Json file content, also bakes the asset manifest in. False if it's not a scene
+        bool convertFile(const std::string& jsonFilename, const std::string& binaryFilename);
+
+        bool saveFile(const std::vector<uint8_t>& data, const std::string& filename);
+    }
+
+
+    class SceneBinaryWriter final
+    {
+    public:
+        void setExtras(const Json::Value& extras) { m_extras = extras; }
+        void setSourceHash(uint64_t sourceHash) { m_sourceHash = sourceHash; }
+
+        // Follow each entity with its componentCount components
+        void writeEntity(const SceneEntityRecord& record);
+        void writeComponent(const Json::Value& json);
+
+        void finish(std::vector<uint8_t>& out);
+
+    private:
+        uint32_t intern(const std::string& str);
+        void writeValue(std::vector<uint8_t>& out, const Json::Value& value);
+
+        template<typename T>
+        static void write(std::vector<uint8_t>& out, const T& value)
+        {
+            auto pBytes = (const uint8_t*)&value;
+            out.insert(out.end(), pBytes, pBytes + sizeof(T));
+        }
+
+        std::vector<std::string> m_strings;
+        std::unordered_map<std::string, uint32_t> m_stringIndices;
+        std::vector<uint8_t> m_body;
+        Json::Value m_extras;
+        uint64_t m_sourceHash = 0;
+        uint32_t m_entityCount = 0;
+    };
+
+
+    class SceneBinaryReader final
+    {
+    public:
+        bool open(const uint8_t* pData, size_t size); // Logs and returns false if it's not a scene we can read
+
+        int getEntityCount() const { return (int)m_entityCount; }
+        uint64_t getSourceHash() const { return m_sourceHash; }
+        const Json::Value& getExtras() const { return m_extras; }
+
+        bool readEntity(SceneEntityRecord& out); // False when done, or on error
+        bool readComponent(Json::Value& out);
+        bool hasError() const { return m_error; }
+
+        // Steps over a component, remembering where it was. decodeComponent only reads,
+        // so the blobs can be decoded on worker threads once the records are read.
+        bool skipComponent(size_t& outOffset);
+        bool decodeComponent(size_t offset, Json::Value& out) const;
+
+    private:
+        bool readValue(Json::Value& out, int depth);
+        bool readString(const std::string*& pOut);
+
+        // Don't touch the reader's state or log, failing is up to the caller
+        bool decodeValue(size_t& offset, Json::Value& out, int depth) const;
+        bool decodeString(size_t& offset, const std::string*& pOut) const;
+        bool skipValue(size_t& offset, int depth) const;
+
+        template<typename T>
+        bool readAt(size_t& offset, T& out) const
+        {
+            if (offset > m_size || m_size - offset < sizeof(T)) return false;
+            memcpy(&out, m_pData + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        template<typename T>
+        bool read(T& out)
+        {
+            if (m_error || !readAt(m_offset, out)) return fail();
+            return true;
+        }
+
+        bool fail();
+
+        const uint8_t* m_pData = nullptr;
+        size_t m_size = 0;
+        size_t m_offset = 0;
+        std::vector<std::string> m_strings;
+        Json::Value m_extras;
+        uint64_t m_sourceHash = 0;
+        uint32_t m_entityCount = 0;
+        uint32_t m_entitiesRead = 0;
+        bool m_error = false;
+    };
+}
@@ -50,6 +50,7 @@ namespace Engine
 	private:
 		void createLuaObj();
 		void destroyLuaObj();
+		void updateNameId();
 
 		LuaComponentDef* m_pLuaComponentDef = nullptr;
 		std::vector<Engine::LuaProperty> m_luaProperties; // This is for lua mostly
@@ -0,0 +1,64 @@
+// Uniform spatial hash of entity world positions, for radius and rect searches.
+// Entities get queued when their world transform is recomputed, and are re-bucketed the next
+// time someone queries, so moving things around doesn't cost anything until then.
+
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace Engine
+{
+    class Entity;
+    class Scene;
+
+    class SpatialGrid;
+    using SpatialGridRef = std::shared_ptr<SpatialGrid>;
+
+
+    class SpatialGrid final
+    {
+    public:
+        static constexpr float DEFAULT_CELL_SIZE = 256.0f;
+
+        SpatialGrid(Scene* pScene, float cellSize = DEFAULT_CELL_SIZE);
+
+        void clear();
+
+        void markDirty(Entity* pEntity); // Position will be re-read on next query
+        void remove(Entity* pEntity);
+        void compact(); // Forgets queued entities that died or were removed since, once a frame in case nothing queries
+
+        // Results are unordered, and include entities that aren't under root anymore
+        void queryRadius(const glm::vec2& center, float radius, std::vector<Entity*>& out, bool inclusive = true);
+        void queryRect(const glm::vec4& rect, std::vector<Entity*>& out); // x, y, w, h, inclusive
+
+        int getCellCount() const { return (int)m_cells.size(); }
+        float getCellSize() const { return m_cellSize; }
+
+    private:
+        using CellKey = uint64_t;
+
+        CellKey getCellKey(int x, int y) const { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+        glm::ivec2 getCellCoords(const glm::vec2& position) const;
+
+        void flush();
+        void insert(Entity* pEntity, CellKey key);
+        void removeFromCell(Entity* pEntity);
+
+        template<typename Fn>
+        void forEachCell(const glm::vec2& min, const glm::vec2& max, Fn fn);
+
+        Scene* m_pScene;
+        float m_cellSize;
+        float m_invCellSize;
+        std::unordered_map<CellKey, std::vector<Entity*>> m_cells;
+        std::vector<uint64_t> m_dirty; // Packed entity handles, entities can die before we flush
+    };
+}
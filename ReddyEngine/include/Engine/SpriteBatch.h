@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Engine/Transform2D.h"
+
 #include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
@@ -34,14 +36,14 @@ namespace Engine
                         const glm::vec4& uvs = { 0, 0, 1, 1 });
 
         void drawSprite(const TextureRef& pTexture, // nullptr for 1x1 white
-                        const glm::mat4& transform, 
+                        const Transform2D& transform, 
                         const glm::vec4& color = { 1, 1, 1, 1 }, 
                         const glm::vec2& scale = {1, 1}, 
                         const glm::vec2& origin = { 0.5f, 0.5f }, 
                         const glm::vec4& uvs = { 0, 0, 1, 1 });
 
         void drawSlice9Sprite(const TextureRef& pTexture, // nullptr for 1x1 white
-                        const glm::mat4& transform, 
+                        const Transform2D& transform, 
                         const glm::vec4& color = { 1, 1, 1, 1 }, 
                         const glm::vec2& scale = {1, 1}, 
                         const glm::vec2& origin = { 0.5f, 0.5f }, 
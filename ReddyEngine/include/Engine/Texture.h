@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Resource.h"
 
@@ -22,18 +23,90 @@ namespace Engine
     };
 
 
+    enum class TextureFilter
+    {
+        Nearest,
+        Linear,
+        Trilinear // Linear between mips. Only different from Linear when the texture has mips
+    };
+
+
+    enum class TextureWrap
+    {
+        Repeat,
+        Clamp
+    };
+
+
+    enum class TextureMipmaps
+    {
+        None,
+        GPU, // glGenerateMipmap at upload, falls back to CPU if not available
+        CPU  // Box filtered on our side
+    };
+
+
+    struct TextureSampler
+    {
+        TextureFilter filter = TextureFilter::Trilinear;
+        TextureWrap wrap = TextureWrap::Repeat;
+    };
+
+
+    struct TextureOptions
+    {
+        TextureMipmaps mipmaps = TextureMipmaps::GPU;
+        TextureSampler sampler;
+        bool allowStreaming = true; // Files of TEXTURE_STREAMING_MIN_SIZE or more stream in. See createStreaming
+    };
+
+
+    static const int TEXTURE_STREAMING_MIN_SIZE = 2048;
+    static const int TEXTURE_THUMBNAIL_SIZE = 128;
+    static const size_t TEXTURE_STREAMING_DEFAULT_BUDGET = 4 * 1024 * 1024; // Bytes uploaded per frame
+
+
+    struct TextureMipLevel
+    {
+        glm::ivec2 size;
+        std::vector<uint8_t> data; // Interleaved RGBA
+    };
+
+
     class Texture : public Resource
     {
     public:
         static constexpr char* SUPPORTED_FORMATS[] = { "jpg", "jpeg", "png", "bmp", "tga", "psd" };
 
         // Data is interleaved RGBA
-        static TextureRef createFromData(const glm::ivec2& size, const uint8_t* pData);
-        static TextureRef createFromFile(const std::string& filename);
+        static TextureRef createFromData(const glm::ivec2& size, const uint8_t* pData, const TextureOptions& options = {});
+        static TextureRef createFromFile(const std::string& filename, const TextureOptions& options = {});
+
+        // Reads and decodes to premultiplied RGBA. No GL, safe to call from jobs.
+        // With skipStreamed, images big enough to stream only get outSize filled, outPixels stays empty.
+        static bool decodeFile(const std::string& filename, glm::ivec2& outSize, std::vector<uint8_t>& outPixels, bool skipStreamed = false);
+
+        // Full size storage is allocated right away, but only a low res mip is shown (the "<filename>.thumb" cooked
+        // in the pack, or transparent until decoded). The full res is decoded on the job system and uploaded in
+        // tiles by updateStreaming(). The Texture and its GL handle never change.
+        static TextureRef createStreaming(const std::string& filename, const glm::ivec2& size, const TextureSampler& sampler = {});
+        static void updateStreaming(); // Once per frame, on the main thread
+        static void setStreamingBudget(size_t bytesPerFrame);
+
+        // Pack cooking. Fills outThumbnail for textures big enough to be streamed.
+        static bool cookThumbnail(const uint8_t* pFileData, size_t fileSize, std::vector<uint8_t>& outThumbnail);
         static TextureRef createDynamic(const glm::ivec2& size, TextureFormat format = TextureFormat::R8G8B8A8);
 
+        // Box filtered mip chain, from the level below pData down to 1x1. Doesn't touch GL.
+        static std::vector<TextureMipLevel> generateMipChain(const glm::ivec2& size, const uint8_t* pData);
+
         void setData(const uint8_t* data); // For dynamic textures only
 
+        void setSampler(const TextureSampler& sampler);
+        const TextureSampler& getSampler() const { return m_sampler; }
+        bool hasMipmaps() const { return m_mipCount > 1; }
+        bool isStreaming() const { return m_isStreaming; }
+
         GLuint getHandle() const { return m_handle; }
 
         const glm::ivec2& getSize() const { return m_size; }
@@ -43,9 +116,14 @@ namespace Engine
     private:
         Texture();
 
+        void applySampler();
+
         glm::ivec2 m_size = { 0, 0 };
         GLuint m_handle = 0;
         bool m_isDynamic = false;
         TextureFormat m_format = TextureFormat::R8G8B8A8;
+        TextureSampler m_sampler;
+        int m_mipCount = 1;
+        bool m_isStreaming = false;
     };
 }
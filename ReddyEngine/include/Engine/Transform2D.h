@@ -0,0 +1,81 @@
+// 2D affine transform, a 2x2 basis plus a translation (3x2 matrix, column major like glm).
+// A quarter of a mat4, and composing/transforming points skips all the z and w math.
+
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/trigonometric.hpp>
+
+#include <cmath>
+#include <limits>
+
+
+namespace Engine
+{
+    struct Transform2D
+    {
+        glm::vec2 xAxis = { 1.0f, 0.0f };
+        glm::vec2 yAxis = { 0.0f, 1.0f };
+        glm::vec2 translation = { 0.0f, 0.0f };
+
+        // Same as translate * rotate(z) * scale
+        static Transform2D fromTRS(const glm::vec2& position, float degrees, const glm::vec2& scale = { 1.0f, 1.0f })
+        {
+            auto radians = glm::radians(degrees);
+            auto c = std::cos(radians);
+            auto s = std::sin(radians);
+
+            Transform2D transform;
+            transform.xAxis = glm::vec2(c, s) * scale.x;
+            transform.yAxis = glm::vec2(-s, c) * scale.y;
+            transform.translation = position;
+            return transform;
+        }
+
+        Transform2D operator*(const Transform2D& other) const
+        {
+            Transform2D transform;
+            transform.xAxis = xAxis * other.xAxis.x + yAxis * other.xAxis.y;
+            transform.yAxis = xAxis * other.yAxis.x + yAxis * other.yAxis.y;
+            transform.translation = xAxis * other.translation.x + yAxis * other.translation.y + translation;
+            return transform;
+        }
+
+        // Transforms a point
+        glm::vec2 operator*(const glm::vec2& point) const { return xAxis * point.x + yAxis * point.y + translation; }
+
+        glm::vec2 transformVector(const glm::vec2& vector) const { return xAxis * vector.x + yAxis * vector.y; }
+
+        // Scales the local axes, like multiplying by a scale matrix on the right
+        Transform2D scaled(const glm::vec2& scale) const
+        {
+            Transform2D transform;
+            transform.xAxis = xAxis * scale.x;
+            transform.yAxis = yAxis * scale.y;
+            transform.translation = translation;
+            return transform;
+        }
+
+        // Degenerate transforms (scale 0) have no inverse. Every point goes to infinity instead, so
+        // local bounds checks (mouse picking) always miss
+        Transform2D inverse() const
+        {
+            auto det = xAxis.x * yAxis.y - yAxis.x * xAxis.y;
+            if (det == 0.0f)
+            {
+                Transform2D transform;
+                transform.translation = glm::vec2(std::numeric_limits<float>::infinity());
+                return transform;
+            }
+
+            auto invDet = 1.0f / det;
+            Transform2D transform;
+            transform.xAxis = glm::vec2(yAxis.y, -xAxis.y) * invDet;
+            transform.yAxis = glm::vec2(-yAxis.x, xAxis.x) * invDet;
+            transform.translation = -(transform.xAxis * translation.x + transform.yAxis * translation.y);
+            return transform;
+        }
+
+        float getRotation() const { return glm::degrees(std::atan2(xAxis.y, xAxis.x)); }
+    };
+}
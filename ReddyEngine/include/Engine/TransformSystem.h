@@ -0,0 +1,57 @@
+// Keeps the scene's entities in a flat parent-before-child array, and propagates dirty world
+// transforms in one linear pass. Moving an entity only flags it, children find out through their
+// parent's version. Entity getters still work between passes, they just walk up their parents.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace Engine
+{
+    class Entity;
+    class Scene;
+
+    class TransformSystem;
+    using TransformSystemRef = std::shared_ptr<TransformSystem>;
+
+
+    class TransformSystem final
+    {
+    public:
+        static const int PARALLEL_MIN_ENTITIES = 4096; // Under this, jobs cost more than they save
+        static const int BATCH_MIN_ENTITIES = 1024;
+
+        TransformSystem(Scene* pScene);
+
+        void markDirty() { m_hasDirty = true; }
+        void markHierarchyDirty() { m_orderDirty = true; } // Children added/removed somewhere
+        bool hasPending() const { return m_hasDirty || m_orderDirty; }
+        uint32_t getOrderStamp() const { return m_orderStamp; }
+
+        void update(); // Brings every world transform under root up to date
+
+        int getEntityCount() const { return (int)m_order.size(); }
+
+    private:
+        struct Batch
+        {
+            int begin;
+            int end;
+            std::vector<Entity*> changed;
+        };
+
+        void rebuildOrder();
+        void appendSubtree(Entity* pEntity);
+
+        Scene* m_pScene;
+        std::vector<Entity*> m_order; // Root first, then each of root's children subtrees contiguous
+        std::vector<Batch> m_batches; // Whole subtrees of root's children, independent from each other
+        std::vector<Entity*> m_stack;
+        uint32_t m_orderStamp = 0;
+        bool m_hasDirty = true;
+        bool m_orderDirty = true;
+    };
+}
@@ -0,0 +1,154 @@
+#include "Engine/AssetManifest.h"
+#include "Engine/FileSystem.h"
+#include "Engine/Log.h"
+#include "Engine/ResourceId.h"
+#include "Engine/Utils.h"
+
+#include <unordered_set>
+
+
+static const int MANIFEST_VERSION = 1;
+
+
+namespace Engine
+{
+    class ManifestBuilder
+    {
+    public:
+        AssetManifest manifest;
+
+        // Keys components and asset files use to reference other assets
+        void walk(const Json::Value& json)
+        {
+            if (json.isArray())
+            {
+                for (const auto& child : json) walk(child);
+                return;
+            }
+            if (!json.isObject()) return;
+
+            for (auto it = json.begin(); it != json.end(); ++it)
+            {
+                const auto& key = it.name();
+                const auto& value = *it;
+                if (value.isString())
+                {
+                    if (key == "texture") add(manifest.textures, value.asString());
+                    else if (key == "font") add(manifest.fonts, value.asString());
+                    else if (key == "pfx") add(manifest.pfxs, value.asString());
+                    else if (key == "frameAnim") add(manifest.frameAnims, value.asString());
+                }
+                else walk(value);
+            }
+        }
+
+        // PFX and FrameAnim files reference textures themselves
+        void walkNestedFiles()
+        {
+            for (size_t i = 0; i < manifest.pfxs.size(); ++i)
+            {
+                add(manifest.textures, "textures/particle.png"); // Emitters default to it
+                walkFile(manifest.pfxs[i]);
+            }
+            for (size_t i = 0; i < manifest.frameAnims.size(); ++i)
+                walkFile(manifest.frameAnims[i]);
+        }
+
+    private:
+        void add(std::vector<std::string>& list, const std::string& path)
+        {
+            if (path.empty()) return;
+            if (m_added.insert(hashPathChars(path.c_str(), path.size(), ASSETS_PATH_SEED)).second)
+                list.push_back(path);
+        }
+
+        void walkFile(const std::string& path)
+        {
+            Json::Value json;
+            if (Utils::loadJson(json, "assets/" + path)) walk(json);
+        }
+
+        std::unordered_set<uint64_t> m_added; // Same path can be written with different slashes/case
+    };
+
+
+    AssetManifest AssetManifest::scan(const Json::Value& json)
+    {
+        ManifestBuilder builder;
+        builder.walk(json);
+        builder.walkNestedFiles();
+        return builder.manifest;
+    }
+
+    std::string AssetManifest::getManifestFilename(const std::string& sceneFilename)
+    {
+        return Utils::getPathWithoutExtension(sceneFilename) + ".manifest.json";
+    }
+
+    AssetManifest AssetManifest::loadOrScan(const std::string& sceneFilename, const Json::Value& sceneJson)
+    {
+        uint64_t sourceHash = 0;
+        {
+            FileSystem::FileData fileData;
+            if (FileSystem::readFile(sceneFilename, fileData))
+                sourceHash = hashBytes(fileData.pData, fileData.size);
+        }
+
+        auto manifestFilename = getManifestFilename(sceneFilename);
+        if (sourceHash && FileSystem::fileExists(manifestFilename))
+        {
+            Json::Value json;
+            if (Utils::loadJson(json, manifestFilename))
+            {
+                AssetManifest cached;
+                cached.deserialize(json);
+                if (cached.sourceHash == sourceHash) return cached;
+            }
+        }
+
+        auto manifest = scan(sceneJson);
+        manifest.sourceHash = sourceHash;
+
+        // Only loose scenes get a cache, packs are read only
+        if (sourceHash && Utils::fileExists(sceneFilename))
+            Utils::saveJson(manifest.serialize(), manifestFilename);
+
+        return manifest;
+    }
+
+    Json::Value AssetManifest::serialize() const
+    {
+        auto serializeList = [](const std::vector<std::string>& list)
+        {
+            Json::Value json(Json::arrayValue);
+            for (const auto& path : list) json.append(path);
+            return json;
+        };
+
+        Json::Value json;
+        json["version"] = MANIFEST_VERSION;
+        json["sourceHash"] = Json::Value((Json::UInt64)sourceHash);
+        json["textures"] = serializeList(textures);
+        json["fonts"] = serializeList(fonts);
+        json["pfx"] = serializeList(pfxs);
+        json["frameAnims"] = serializeList(frameAnims);
+        return json;
+    }
+
+    void AssetManifest::deserialize(const Json::Value& json)
+    {
+        auto deserializeList = [](std::vector<std::string>& list, const Json::Value& json)
+        {
+            list.clear();
+            for (const auto& path : json) list.push_back(path.asString());
+        };
+
+        if (Utils::deserializeInt32(json["version"], 0) != MANIFEST_VERSION) return; // Stays invalid, will be rebuilt
+
+        sourceHash = json["sourceHash"].isUInt64() ? json["sourceHash"].asUInt64() : 0;
+        deserializeList(textures, json["textures"]);
+        deserializeList(fonts, json["fonts"]);
+        deserializeList(pfxs, json["pfx"]);
+        deserializeList(frameAnims, json["frameAnims"]);
+    }
+}
@@ -7,6 +7,7 @@
 #include "Engine/SpriteBatch.h"
 #include "Engine/ResourceManager.h"
 #include "Engine/Constants.h"
+#include "ComponentManager.h"
 
 
 namespace Engine
@@ -20,10 +21,28 @@ namespace Engine
 
 	Component::Component()
 	{
+		if (getScene()) m_handle = getScene()->registerComponent(this);
+	}
+
+	Component::Component(const Component& other)
+		: m_nameId(other.m_nameId)
+		, m_isEnabled(other.m_isEnabled)
+		, m_typeId(other.m_typeId)
+		, m_updatePhases(other.m_updatePhases)
+		, m_isDrawable(other.m_isDrawable)
+		, m_tickPolicy(other.m_tickPolicy)
+		, m_pPool(other.m_pPool)
+	{
+		if (getScene()) m_handle = getScene()->registerComponent(this);
 	}
 
 	Component::~Component()
 	{
+		if (getScene())
+		{
+			getScene()->unregisterComponent(m_handle);
+			if (getScene()->getComponentManager()) getScene()->getComponentManager()->unlistComponent(this);
+		}
 	}
 	
 	EntityRef Component::getEntity()
@@ -41,21 +60,42 @@ namespace Engine
 		if (!m_isEnabled)
 		{
 			m_isEnabled = true;
+			markChanged();
+			if (m_isCreated) getScene()->getComponentManager()->refreshUpdateLists(this);
 			if (m_pEntity->enabled)
 				onEnable();
 		}
 	}
 
+	void Component::markChanged()
+	{
+		if (m_pEntity) m_pEntity->markChanged();
+	}
+
 	void Component::disable()
 	{
 		if (m_isEnabled)
 		{
 			m_isEnabled = false;
+			markChanged();
+			if (m_isCreated) getScene()->getComponentManager()->refreshUpdateLists(this);
 			if (m_pEntity->enabled)
 				onDisable();
 		}
 	}
 
+	void Component::setUpdatePhases(uint8_t phases)
+	{
+		m_updatePhases = phases;
+		if (m_isCreated) getScene()->getComponentManager()->refreshUpdateLists(this);
+	}
+
+	void Component::setTickPolicy(const TickPolicy& tickPolicy)
+	{
+		m_tickPolicy = tickPolicy;
+		m_skippedTime = 0.0f;
+	}
+
 	Json::Value Component::serialize()
 	{
 		Json::Value json;
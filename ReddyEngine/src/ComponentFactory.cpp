@@ -22,6 +22,42 @@ namespace Engine
 
     std::map<std::string, CreateComponentFn> ComponentFactory::s_factories;
     std::vector<std::string> ComponentFactory::s_componentNames;
+    std::vector<std::unique_ptr<ComponentPool>> ComponentFactory::s_pools;
+    std::unordered_map<std::string, ComponentTypeId> ComponentFactory::s_typeIds;
+
+    ComponentPool* ComponentFactory::createPool(size_t stride, ComponentPool::ToComponentFn toComponent, ComponentPool::ResetFn reset, ComponentPool::CloneFn clone)
+    {
+        s_pools.push_back(std::make_unique<ComponentPool>(stride, toComponent, reset, clone));
+        return s_pools.back().get();
+    }
+
+    bool ComponentFactory::recycle(ComponentRef& pComponent)
+    {
+        if (!pComponent || !pComponent->m_pPool) return false;
+        return pComponent->m_pPool->recycle(pComponent);
+    }
+
+    ComponentRef ComponentFactory::clone(const ComponentRef& pPrototype)
+    {
+        if (!canClone(pPrototype)) return nullptr;
+        return pPrototype->m_pPool->getCloneFn()(pPrototype.get());
+    }
+
+    bool ComponentFactory::canClone(const ComponentRef& pComponent)
+    {
+        return pComponent && pComponent->m_pPool && pComponent->m_pPool->getCloneFn();
+    }
+
+    CreateComponentFn ComponentFactory::getFactory(const std::string& name)
+    {
+        auto it = s_factories.find(name);
+        return it != s_factories.end() ? it->second : nullptr;
+    }
+
+    void ComponentFactory::clearRecycled()
+    {
+        for (const auto& pPool : s_pools) pPool->clearRecycled();
+    }
 
     bool ComponentFactory::registerFactory(const std::string& name, CreateComponentFn fn)
     {
@@ -50,6 +86,23 @@ namespace Engine
         return it->second();
     }
 
+    ComponentTypeId ComponentFactory::internName(const std::string& name)
+    {
+        auto it = s_typeIds.find(name);
+        if (it != s_typeIds.end()) return it->second;
+
+        auto typeId = (ComponentTypeId)s_typeIds.size();
+        s_typeIds[name] = typeId;
+        return typeId;
+    }
+
+    ComponentTypeId ComponentFactory::findTypeId(const std::string& name)
+    {
+        auto it = s_typeIds.find(name);
+        if (it == s_typeIds.end()) return INVALID_COMPONENT_TYPE;
+        return it->second;
+    }
+
     const std::vector<std::string>& ComponentFactory::getComponentNames()
     {
         return s_componentNames;
@@ -1,26 +1,51 @@
 #include "ComponentManager.h"
 #include "Engine/Component.h"
+#include "Engine/ComponentFactory.h"
 #include "Engine/Scene.h"
 #include "Engine/ReddyEngine.h"
 #include "Engine/Entity.h"
+#include "Engine/JobSystem.h"
+#include "Engine/Log.h"
+
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
 
 
 namespace Engine
 {
     void ComponentManager::clear()
     {
-        m_components.clear();
         m_commands.clear();
+
+        // Components can outlive this, they'd point at slots that are gone
+        for (int phase = 0; phase < UPDATE_PHASE_COUNT; ++phase)
+        {
+            auto& list = m_updateLists[phase];
+            for (auto pComponent : list.components)
+                if (pComponent) pComponent->m_updateListIndex[phase] = -1;
+            list.components.clear();
+            list.hasHoles = false;
+        }
     }
 
     void ComponentManager::addComponent(const ComponentRef& pComponent)
     {
-        m_commands.push_back({CommandType::Create, pComponent});
+        CORE_ASSERT(!m_isInParallelPhase, "Components can't be created from a parallel update");
+        m_commands.push_back({CommandType::Create, pComponent, nullptr});
     }
 
     void ComponentManager::removeComponent(const ComponentRef& pComponent)
     {
-        m_commands.push_back({CommandType::Destroy, pComponent});
+        CORE_ASSERT(!m_isInParallelPhase, "Components can't be removed from a parallel update, destroy the entity instead");
+        m_commands.push_back({CommandType::Destroy, pComponent, nullptr});
+    }
+
+    void ComponentManager::deferDestroyEntity(const EntityRef& pEntity)
+    {
+        std::lock_guard<std::mutex> lock(m_commandsMutex);
+        m_commands.push_back({CommandType::DestroyEntity, nullptr, pEntity});
     }
 
     void ComponentManager::processCommands()
@@ -35,6 +60,8 @@ namespace Engine
                 switch (command.type)
                 {
                     case CommandType::Create:
+                        command.pComponent->m_isCreated = true;
+                        refreshUpdateLists(command.pComponent.get());
                         command.pComponent->onCreate();
                         if (command.pComponent->isEnabled() && command.pComponent->getEntity()->enabled)
                             command.pComponent->onEnable();
@@ -44,6 +71,13 @@ namespace Engine
                         if (command.pComponent->isEnabled() && command.pComponent->getEntity()->enabled)
                             command.pComponent->onDisable();
                         command.pComponent->onDestroy();
+                        command.pComponent->m_isCreated = false;
+                        refreshUpdateLists(command.pComponent.get());
+                        break;
+
+                    case CommandType::DestroyEntity:
+                        if (command.pEntity->getParent()) // Could've been destroyed twice
+                            getScene()->destroyEntity(command.pEntity);
                 }
             }
         }
@@ -51,6 +85,145 @@ namespace Engine
         m_commandsCopy.clear();
     }
 
+    void ComponentManager::refreshUpdateLists(Component* pComponent)
+    {
+        for (int phase = 0; phase < UPDATE_PHASE_COUNT; ++phase)
+        {
+            bool wanted = pComponent->m_isCreated && pComponent->m_isEnabled && (pComponent->m_updatePhases & (1 << phase));
+            bool listed = pComponent->m_updateListIndex[phase] != -1;
+            if (wanted && !listed) addToUpdateList(phase, pComponent);
+            else if (!wanted && listed) removeFromUpdateList(phase, pComponent);
+        }
+    }
+
+    void ComponentManager::unlistComponent(Component* pComponent)
+    {
+        for (int phase = 0; phase < UPDATE_PHASE_COUNT; ++phase)
+            if (pComponent->m_updateListIndex[phase] != -1)
+                removeFromUpdateList(phase, pComponent);
+    }
+
+    void ComponentManager::addToUpdateList(int phase, Component* pComponent)
+    {
+        auto& list = m_updateLists[phase];
+        pComponent->m_updateListIndex[phase] = (int)list.components.size();
+        list.components.push_back(pComponent);
+    }
+
+    void ComponentManager::removeFromUpdateList(int phase, Component* pComponent)
+    {
+        auto& list = m_updateLists[phase];
+        auto index = pComponent->m_updateListIndex[phase];
+        pComponent->m_updateListIndex[phase] = -1;
+        if (index >= (int)list.components.size() || list.components[index] != pComponent) return; // Stale
+
+        // Swapping the last one in would reorder updates, and it'd move things under a running loop
+        list.components[index] = nullptr;
+        list.hasHoles = true;
+    }
+
+    void ComponentManager::compactUpdateList(int phase)
+    {
+        auto& list = m_updateLists[phase];
+        if (!list.hasHoles) return;
+
+        int count = 0;
+        for (auto pComponent : list.components)
+        {
+            if (!pComponent) continue;
+            pComponent->m_updateListIndex[phase] = count;
+            list.components[count++] = pComponent;
+        }
+        list.components.resize(count);
+        list.hasHoles = false;
+    }
+
+    // Only components that are created, enabled and tick in that phase are listed. Entity enabled
+    // state is hierarchical, so that part (and detached entities) is still checked here.
+    template<typename Fn>
+    void ComponentManager::forEachUpdatable(int phase, Fn fn)
+    {
+        auto pRoot = getScene()->getRoot().get();
+        compactUpdateList(phase);
+        auto& components = m_updateLists[phase].components;
+
+        for (size_t i = 0; i < components.size(); ++i) // Components added by fn are appended and visited too
+        {
+            auto pComponent = components[i];
+            if (pComponent && pComponent->m_pEntity->isEnabledInScene(pRoot))
+                fn(pComponent);
+        }
+    }
+
+    bool ComponentManager::consumeTick(Component* pComponent, float dt, float& outDt)
+    {
+        const auto& policy = pComponent->m_tickPolicy;
+        if (policy.isEveryFrame())
+        {
+            outDt = dt;
+            return true;
+        }
+
+        auto interval = policy.interval;
+        const auto& screenRect = getScene()->getScreenRect();
+        if (screenRect.z != 0.0f || screenRect.w != 0.0f) // Not set, nothing is off screen
+        {
+            auto position = pComponent->m_pEntity->getWorldPosition();
+            auto rectMin = glm::min(glm::vec2(screenRect.x, screenRect.y), glm::vec2(screenRect.x + screenRect.z, screenRect.y + screenRect.w));
+            auto rectMax = glm::max(glm::vec2(screenRect.x, screenRect.y), glm::vec2(screenRect.x + screenRect.z, screenRect.y + screenRect.w));
+            auto distance = glm::length(glm::max(glm::max(rectMin - position, position - rectMax), glm::vec2(0.0f)));
+
+            if (policy.dormantDistance > 0.0f && distance > policy.dormantDistance)
+            {
+                pComponent->m_skippedTime = 0.0f;
+                return false;
+            }
+            if (distance > 0.0f) interval = std::max(interval, policy.offscreenInterval);
+        }
+
+        pComponent->m_skippedTime += dt;
+        if (interval > 1 && (m_frame + pComponent->m_handle.index) % (uint32_t)interval != 0) return false; // Staggered, so they don't all land on the same frame
+
+        outDt = pComponent->m_skippedTime;
+        pComponent->m_skippedTime = 0.0f;
+        return true;
+    }
+
+    // Lists can't change under us here, nothing structural is allowed from these updates
+    void ComponentManager::parallelUpdate(float dt)
+    {
+        compactUpdateList(UPDATE_PHASE_PARALLEL_UPDATE);
+        auto& components = m_updateLists[UPDATE_PHASE_PARALLEL_UPDATE].components;
+        if (components.empty()) return;
+
+        // Who ticks is decided up front, world positions can't be read from workers
+        auto pRoot = getScene()->getRoot().get();
+        m_parallelDts.resize(components.size());
+        for (size_t i = 0; i < components.size(); ++i)
+        {
+            auto pComponent = components[i];
+            float tickDt;
+            m_parallelDts[i] = pComponent->m_pEntity->isEnabledInScene(pRoot) && consumeTick(pComponent, dt, tickDt) ? tickDt : -1.0f;
+        }
+
+        auto& dts = m_parallelDts;
+        auto updateOne = [&components, &dts](int i)
+        {
+            if (dts[i] >= 0.0f)
+                components[i]->update(dts[i]);
+        };
+
+        m_isInParallelPhase = true;
+
+        const auto& pJobSystem = getJobSystem();
+        if (pJobSystem)
+            pJobSystem->parallelFor((int)components.size(), updateOne, PARALLEL_BATCH_SIZE);
+        else
+            for (int i = 0; i < (int)components.size(); ++i) updateOne(i);
+
+        m_isInParallelPhase = false;
+    }
+
     void ComponentManager::update(float dt)
     {
         if (getScene()->isEditorScene()) // Editor doesn't update entities or fire their events
@@ -59,11 +232,17 @@ namespace Engine
             return;
         }
 
+        processCommands();
+        ++m_frame;
+
+        parallelUpdate(dt);
         processCommands();
 
-        getScene()->getRoot()->collectUpdatables(m_components);
-        for (const auto& pComponent : m_components) pComponent->update(dt);
-        m_components.clear();
+        forEachUpdatable(UPDATE_PHASE_UPDATE, [this, dt](Component* pComponent)
+        {
+            float tickDt;
+            if (consumeTick(pComponent, dt, tickDt)) pComponent->update(tickDt);
+        });
 
         processCommands();
     }
@@ -78,9 +257,7 @@ namespace Engine
 
         processCommands();
         
-        getScene()->getRoot()->collectUpdatables(m_components);
-        for (const auto& pComponent : m_components) pComponent->fixedUpdate(dt);
-        m_components.clear();
+        forEachUpdatable(UPDATE_PHASE_FIXED_UPDATE, [dt](Component* pComponent) { pComponent->fixedUpdate(dt); });
 
         processCommands();
     }
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Engine/ComponentFactory.h"
+
 #include <memory>
+#include <mutex>
 #include <vector>
 
 
@@ -9,6 +12,9 @@ namespace Engine
     class Component;
     using ComponentRef = std::shared_ptr<Component>;
 
+    class Entity;
+    using EntityRef = std::shared_ptr<Entity>;
+
 
     class ComponentManager
     {
@@ -21,23 +27,55 @@ namespace Engine
         void update(float dt);
         void fixedUpdate(float dt);
 
+        // Keeps the component in the update lists of its phases while it's created and enabled
+        void refreshUpdateLists(Component* pComponent);
+        void unlistComponent(Component* pComponent); // Being destroyed
+
+        bool isInParallelPhase() const { return m_isInParallelPhase; }
+        void deferDestroyEntity(const EntityRef& pEntity); // Thread safe, destroyed once the parallel phase is done
+
+        int getUpdateListSize(int phase) const { return (int)m_updateLists[phase].components.size(); }
+
     private:
+        static const int PARALLEL_BATCH_SIZE = 64;
+
         enum class CommandType
         {
             Create,
-            Destroy
+            Destroy,
+            DestroyEntity
         };
 
         struct Command
         {
             CommandType type;
             ComponentRef pComponent;
+            EntityRef pEntity; // DestroyEntity only
+        };
+
+        // In the order components were listed. Removing leaves a hole, compacted before the next pass
+        struct UpdateList
+        {
+            std::vector<Component*> components;
+            bool hasHoles = false;
         };
 
         void processCommands();
+        void addToUpdateList(int phase, Component* pComponent);
+        void removeFromUpdateList(int phase, Component* pComponent);
+        void compactUpdateList(int phase);
+        void parallelUpdate(float dt);
+        bool consumeTick(Component* pComponent, float dt, float& outDt); // Reads world positions, main thread only
+
+        template<typename Fn>
+        void forEachUpdatable(int phase, Fn fn);
 
         std::vector<Command> m_commands;
         std::vector<Command> m_commandsCopy;
-        std::vector<ComponentRef> m_components; // Collected cache
+        UpdateList m_updateLists[UPDATE_PHASE_COUNT];
+        std::vector<float> m_parallelDts; // Per parallel update list entry, negative when it doesn't tick this frame
+        uint32_t m_frame = 0; // Throttled components tick when (frame + their handle index) lands on their interval
+        bool m_isInParallelPhase = false;
+        std::mutex m_commandsMutex; // Only needed during the parallel phase
     };
 }
@@ -0,0 +1,106 @@
+#include "Engine/ComponentPool.h"
+#include "Engine/Log.h"
+
+#include <new>
+
+
+namespace Engine
+{
+    ComponentPool::ComponentPool(size_t stride, ToComponentFn toComponent, ResetFn reset, CloneFn clone)
+        : m_stride(stride)
+        , m_toComponent(toComponent)
+        , m_reset(reset)
+        , m_clone(clone)
+    {
+    }
+
+    ComponentPool::~ComponentPool()
+    {
+        clearRecycled(); // They free into our chunks
+        for (auto& pChunk : m_chunks) ::operator delete(pChunk->pStorage);
+    }
+
+    void* ComponentPool::allocate()
+    {
+        if (!m_freeSlots.empty())
+        {
+            auto pSlot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+            ++m_count;
+            return pSlot;
+        }
+
+        if (m_chunks.empty() || m_chunks.back()->used == CHUNK_SIZE)
+        {
+            auto pChunk = std::make_unique<Chunk>();
+            pChunk->pStorage = (uint8_t*)::operator new(m_stride * CHUNK_SIZE);
+            m_chunks.push_back(std::move(pChunk));
+        }
+
+        auto pChunk = m_chunks.back().get();
+        ++m_count;
+        return pChunk->pStorage + (pChunk->used++) * m_stride;
+    }
+
+    void ComponentPool::free(void* pSlot)
+    {
+        Chunk* pChunk;
+        int index;
+        if (!findSlot(pSlot, pChunk, index))
+        {
+            CORE_ERROR("Freeing a component that doesn't belong to this pool");
+            return;
+        }
+
+        pChunk->alive[index] = false;
+        m_freeSlots.push_back(pSlot);
+        --m_count;
+    }
+
+    void ComponentPool::setAlive(void* pSlot)
+    {
+        Chunk* pChunk;
+        int index;
+        if (findSlot(pSlot, pChunk, index))
+            pChunk->alive[index] = true;
+    }
+
+    bool ComponentPool::recycle(std::shared_ptr<Component>& pComponent)
+    {
+        if (!m_reset || pComponent.use_count() != 1 || (int)m_recycled.size() >= MAX_RECYCLED) return false;
+
+        m_reset(pComponent.get());
+        m_recycled.push_back(std::move(pComponent));
+        return true;
+    }
+
+    std::shared_ptr<Component> ComponentPool::takeRecycled()
+    {
+        if (m_recycled.empty()) return nullptr;
+
+        auto pComponent = std::move(m_recycled.back());
+        m_recycled.pop_back();
+        return pComponent;
+    }
+
+    void ComponentPool::clearRecycled()
+    {
+        std::vector<std::shared_ptr<Component>> recycled;
+        recycled.swap(m_recycled); // Destructing them calls back into free()
+    }
+
+    bool ComponentPool::findSlot(void* pSlot, Chunk*& pChunk, int& index) const
+    {
+        auto pBytes = (uint8_t*)pSlot;
+        for (const auto& pCandidate : m_chunks)
+        {
+            if (pBytes >= pCandidate->pStorage && pBytes < pCandidate->pStorage + m_stride * CHUNK_SIZE)
+            {
+                pChunk = pCandidate.get();
+                index = (int)((pBytes - pChunk->pStorage) / m_stride);
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -12,14 +12,21 @@ extern "C" {
 #include "Engine/Scene.h"
 #include "Engine/ReddyEngine.h"
 #include "Engine/GUI.h"
+#include "Engine/JobSystem.h"
 #include "Engine/ScriptComponent.h"
 #include "Engine/LuaBindings.h"
+#include "Engine/SpatialGrid.h"
+#include "Engine/TransformSystem.h"
 #include "ComponentManager.h"
 
 #include <imgui.h>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <bitset>
+#include <cmath>
 #include <functional>
+#include <unordered_map>
 
 
 static uint64_t g_nextRuntimeId = 1;
@@ -32,6 +39,8 @@ namespace Engine
         runtimeId = g_nextRuntimeId++;
         luaName = "EINS_" + std::to_string(runtimeId);
 
+		if (getScene()) m_handle = getScene()->registerEntity(this);
+
 		if (getScene() && !getScene()->isEditorScene())
 		{
 			auto L = getLuaBindings()->getState();
@@ -39,7 +48,7 @@ namespace Engine
 
 			lua_getglobal(L, "EINS_t");
 			lua_newtable(L);
-			lua_pushlightuserdata(L, this);
+			lua_pushlightuserdata(L, m_handle.toUserData());
 			lua_setfield(L, -2, "EOBJ");
 			lua_setfield(L, -2, luaName.c_str());
 			lua_pop(L, lua_gettop(L));
@@ -48,6 +57,8 @@ namespace Engine
 
 	Entity::~Entity()
 	{
+		releaseFromScene();
+
 		if (getScene() && !getScene()->isEditorScene())
 		{
 			auto L = getLuaBindings()->getState();
@@ -71,10 +82,106 @@ namespace Engine
 		}
 	}
 
+	void Entity::releaseFromScene()
+	{
+		const auto& pScene = getScene();
+		if (!pScene) return;
+
+		pScene->unregisterEntity(m_handle);
+		pScene->unindexEntity(this);
+		pScene->unindexEntityName(this);
+		if (pScene->getSpatialGrid()) pScene->getSpatialGrid()->remove(this);
+		if (pScene->getTransformSystem()) pScene->getTransformSystem()->markHierarchyDirty();
+		while (!m_sceneComponentIndex.empty())
+			pScene->unindexEntityComponent(this, m_sceneComponentIndex.back().first);
+	}
+
+	// Children were already taken away by the scene. Vectors are cleared, not shrunk, so the
+	// next entity using us doesn't allocate.
+	void Entity::resetForReuse()
+	{
+		releaseFromScene();
+		m_handle = EntityHandle();
+
+		// Recycling resets the component. One still held elsewhere isn't, and keeps pointing at us
+		for (auto& pComponent : m_components)
+			ComponentFactory::recycle(pComponent);
+		m_components.clear();
+		m_indexedComponents.clear();
+		m_componentMask = 0;
+
+		id = 0;
+		name.clear();
+		m_hasChanges = false;
+		m_isSaved = false;
+		sortChildren = false;
+		mouseChildren = true;
+		clickThrough = false;
+		uiRoot = false;
+		lockScale = true;
+		enabled = true;
+		isSelected = false;
+		expanded = true;
+		editorVisible = true;
+		editorLocked = false;
+
+		// m_worldVersion keeps counting, so children caching our version never match by accident
+		m_transform = Transform();
+		m_transformDirty = true;
+		m_inverseDirty = true;
+		m_parentVersion = 0;
+		m_orderStamp = 0;
+		m_pParent = nullptr;
+		m_childIndex = -1;
+		m_children.clear();
+		m_sortedChildren.clear();
+		m_sortedChildrenDirty = true;
+
+		if (getScene() && !getScene()->isEditorScene())
+		{
+			auto L = getLuaBindings()->getState();
+			if (!L) return;
+
+			// Same as dying, scripts still holding our table must get nil out of it
+			lua_getglobal(L, "EINS_t");
+			lua_getfield(L, -1, luaName.c_str());
+			if (!lua_isnil(L, -1))
+			{
+				lua_pushnil(L);
+				lua_setfield(L, -2, "EOBJ");
+				lua_pop(L, 1);
+
+				lua_pushnil(L);
+				lua_setfield(L, -2, luaName.c_str());
+			}
+			lua_pop(L, lua_gettop(L));
+		}
+	}
+
+	void Entity::reuse()
+	{
+		if (getScene()) m_handle = getScene()->registerEntity(this);
+
+		if (getScene() && !getScene()->isEditorScene())
+		{
+			auto L = getLuaBindings()->getState();
+			if (!L) return;
+
+			// A fresh table, the old one went away with the entity that used us before
+			lua_getglobal(L, "EINS_t");
+			lua_newtable(L);
+			lua_pushlightuserdata(L, m_handle.toUserData());
+			lua_setfield(L, -2, "EOBJ");
+			lua_setfield(L, -2, luaName.c_str());
+			lua_pop(L, lua_gettop(L));
+		}
+	}
+
 	void Entity::enable()
 	{
 		if (enabled) return;
 		enabled = true;
+		markChanged();
 		for (const auto& pComponent : m_components)
 		{
 			if (!pComponent->isEnabled())
@@ -86,6 +193,7 @@ namespace Engine
 	{
 		if (!enabled) return;
 		enabled = false;
+		markChanged();
 		for (const auto& pComponent : m_components)
 		{
 			if (pComponent->isEnabled())
@@ -95,17 +203,28 @@ namespace Engine
 
 	bool Entity::addChild(EntityRef pChild, int insertAt)
 	{
-		auto worldPos = pChild->getWorldPosition();
+		// Without a parent, local is world
+		auto worldPos = pChild->m_pParent ? pChild->getWorldPosition() : pChild->m_transform.position;
 
 		if (pChild->m_pParent) pChild->m_pParent->removeChild(pChild); // This could potentially make the pChild shared_ptr const reference invalid, that's why we pass by value
-		for (const auto& pMyChild : m_children) if (pMyChild == pChild) return false;
 
-		if (insertAt < 0 || insertAt > (int)m_children.size())
+		if (insertAt < 0 || insertAt >= (int)m_children.size())
+		{
+			pChild->m_childIndex = (int)m_children.size();
 			m_children.push_back(pChild);
+		}
 		else
+		{
 			m_children.insert(m_children.begin() + insertAt, pChild);
+			reindexChildren(insertAt);
+		}
 
 		pChild->m_pParent = this;
+		m_sortedChildrenDirty = true;
+		if (getScene() && getScene()->getTransformSystem()) getScene()->getTransformSystem()->markHierarchyDirty();
+		markChanged(); // Child order
+		pChild->markChanged(); // Parent
+		if (getScene()) getScene()->entityMoved(pChild.get());
 
 		pChild->setWorldPosition(worldPos);
 		return true;
@@ -114,26 +233,81 @@ namespace Engine
 	bool Entity::removeChild(const EntityRef& pChild)
 	{
 		auto rpChild = pChild.get();
-		for (auto it = m_children.begin(); it != m_children.end(); ++it)
+		if (!rpChild || rpChild->m_pParent != this) return false;
+
+		auto index = rpChild->m_childIndex;
+		childDetached(rpChild);
+		m_children.erase(m_children.begin() + index); // Might be pChild's last ref, don't touch it after
+		reindexChildren(index);
+		return true;
+	}
+
+	void Entity::addChildren(const std::vector<EntityRef>& children)
+	{
+		// World positions first, moving one could move another's ancestor
+		std::vector<glm::vec2> worldPositions;
+		worldPositions.reserve(children.size());
+		for (const auto& pChild : children)
+			worldPositions.push_back(pChild->m_pParent ? pChild->getWorldPosition() : pChild->m_transform.position);
+
+		std::vector<Entity*> formerParents;
+		for (const auto& pChild : children)
 		{
-			if (it->get() == rpChild)
-			{
-				rpChild->m_pParent = nullptr;
-				m_children.erase(it);
-				return true;
-			}
+			if (!pChild->m_pParent) continue;
+			formerParents.push_back(pChild->m_pParent);
+			pChild->m_pParent->childDetached(pChild.get());
 		}
-		return false;
+		std::sort(formerParents.begin(), formerParents.end());
+		formerParents.erase(std::unique(formerParents.begin(), formerParents.end()), formerParents.end());
+		for (auto pFormerParent : formerParents)
+			pFormerParent->removeDetachedChildren();
+
+		m_children.reserve(m_children.size() + children.size());
+		for (const auto& pChild : children)
+		{
+			if (pChild->m_pParent == this) continue; // Listed twice
+			pChild->m_childIndex = (int)m_children.size();
+			pChild->m_pParent = this;
+			m_children.push_back(pChild);
+			pChild->markChanged();
+			if (getScene()) getScene()->entityMoved(pChild.get());
+		}
+
+		m_sortedChildrenDirty = true;
+		if (getScene() && getScene()->getTransformSystem()) getScene()->getTransformSystem()->markHierarchyDirty();
+		markChanged();
+
+		for (size_t i = 0; i < children.size(); ++i)
+			children[i]->setWorldPosition(worldPositions[i]);
+	}
+
+	void Entity::childDetached(Entity* pChild)
+	{
+		pChild->m_pParent = nullptr;
+		pChild->m_childIndex = -1;
+		m_sortedChildrenDirty = true;
+		markChanged();
+		if (getScene()) getScene()->entityMoved(pChild);
+		pChild->setDirtyTransform(); // Now relative to nothing
+		if (getScene() && getScene()->getTransformSystem()) getScene()->getTransformSystem()->markHierarchyDirty();
+	}
+
+	void Entity::removeDetachedChildren()
+	{
+		m_children.erase(std::remove_if(m_children.begin(), m_children.end(), [this](const EntityRef& pChild) { return pChild->m_pParent != this; }), m_children.end());
+		reindexChildren(0);
+	}
+
+	void Entity::reindexChildren(int from)
+	{
+		for (int i = from, len = (int)m_children.size(); i < len; ++i)
+			m_children[i]->m_childIndex = i;
 	}
 
 	int Entity::getChildIndex(const EntityRef& pChild) const
 	{
-		for (int i = 0, len = (int)m_children.size(); i < len; ++i)
-		{
-			if (m_children[i] == pChild)
-				return i;
-		}
-		return -1;
+		if (!pChild || pChild->m_pParent != this) return -1;
+		return pChild->m_childIndex;
 	}
 
 	bool Entity::removeComponent(const ComponentRef& pComponent)
@@ -144,6 +318,8 @@ namespace Engine
 			{
 				getScene()->getComponentManager()->removeComponent(pComponent);
 				m_components.erase(it);
+				rebuildComponentIndex();
+				markChanged();
 				return true;
 			}
 		}
@@ -152,200 +328,359 @@ namespace Engine
 
 	void Entity::componentAdded(const ComponentRef& pComponent)
 	{
+		indexComponent(pComponent->getTypeId(), pComponent);
+		if (pComponent->getNameId() != pComponent->getTypeId())
+			indexComponent(pComponent->getNameId(), pComponent);
+		updateSceneComponentIndex();
+
 		getScene()->getComponentManager()->addComponent(pComponent);
+		getScene()->invalidateDrawList();
+		markChanged();
 	}
 
-	EntityRef Entity::getChildByName(const std::string& name, bool recursive)
+	// Bit i of the mask is set when we have a component of type/name id i. m_indexedComponents
+	// holds the first such component for every set bit, so the rank of the bit is its index.
+	void Entity::indexComponent(ComponentTypeId id, const ComponentRef& pComponent)
 	{
-		for (auto it = m_children.begin(); it != m_children.end(); ++it) {
-			const EntityRef &ref = *it;
+		if (id >= COMPONENT_INDEX_BITS) return; // Falls back to a linear search
 
-			if (ref->name == name) {
-				return ref;
-			}
+		auto bit = 1ull << id;
+		if (m_componentMask & bit) return; // Keep the first one
+		
+		auto index = std::bitset<COMPONENT_INDEX_BITS>(m_componentMask & (bit - 1)).count();
+		m_indexedComponents.insert(m_indexedComponents.begin() + index, pComponent);
+		m_componentMask |= bit;
+	}
 
-			if (recursive) {
-				if (auto found_child = ref->getChildByName(name, true)) {
-					return found_child;
-				}
-			}
+	void Entity::rebuildComponentIndex()
+	{
+		m_componentMask = 0;
+		m_indexedComponents.clear();
+		for (const auto& pComponent : m_components)
+		{
+			indexComponent(pComponent->getTypeId(), pComponent);
+			if (pComponent->getNameId() != pComponent->getTypeId())
+				indexComponent(pComponent->getNameId(), pComponent);
 		}
+		updateSceneComponentIndex();
+		if (getScene()) getScene()->invalidateDrawList(); // Removed or reordered
+	}
 
-		return nullptr;
+	// Keeps the scene's component -> entities index in sync with the ids we hold
+	void Entity::updateSceneComponentIndex()
+	{
+		const auto& pScene = getScene();
+		if (!pScene) return;
+
+		std::vector<ComponentTypeId> ids;
+		for (const auto& pComponent : m_components)
+		{
+			if (std::find(ids.begin(), ids.end(), pComponent->getTypeId()) == ids.end()) ids.push_back(pComponent->getTypeId());
+			if (std::find(ids.begin(), ids.end(), pComponent->getNameId()) == ids.end()) ids.push_back(pComponent->getNameId());
+		}
+
+		auto indexed = m_sceneComponentIndex;
+		for (const auto& kv : indexed)
+			if (std::find(ids.begin(), ids.end(), kv.first) == ids.end())
+				pScene->unindexEntityComponent(this, kv.first);
+
+		for (auto id : ids)
+		{
+			auto isIndexed = std::find_if(m_sceneComponentIndex.begin(), m_sceneComponentIndex.end(), [id](const std::pair<ComponentTypeId, int>& kv) { return kv.first == id; });
+			if (isIndexed == m_sceneComponentIndex.end())
+				pScene->indexEntityComponent(this, id);
+		}
 	}
 
-	EntityRef Entity::getChildByName(const std::string& name, const EntitySearchParams& searchParams, bool recursive)
+	void Entity::setName(const std::string& newName)
 	{
-		for (auto it = m_children.begin(); it != m_children.end(); ++it) {
-			const EntityRef &ref = *it;
+		if (newName == name) return;
 
-			if (ref->name == name && (searchParams.radius < FLT_EPSILON || ref->isInRadius(searchParams.pointInWorld, searchParams.radius)))
-			{
-				return ref;
-			}
+		const auto& pScene = getScene();
+		if (pScene) pScene->unindexEntityName(this);
+		name = newName;
+		if (pScene) pScene->indexEntityName(this);
+		markChanged();
+	}
 
-			if (recursive) {
-				if (auto found_child = ref->getChildByName(name, searchParams, true)) {
-					return found_child;
-				}
-			}
+	void Entity::markChanged()
+	{
+		if (m_hasChanges) return;
+
+		const auto& pScene = getScene();
+		if (!pScene || !pScene->isTrackingChanges()) return;
+
+		m_hasChanges = true;
+		pScene->entityChanged(this);
+	}
+
+	void Entity::reorderChildren(const Json::Value& ids, std::vector<EntityRef>& outUnlisted)
+	{
+		std::unordered_map<uint64_t, EntityRef> childrenById;
+		for (auto& pChild : m_children) childrenById[pChild->id] = std::move(pChild);
+		m_children.clear();
+
+		for (const auto& idJson : ids)
+		{
+			auto it = childrenById.find(Utils::deserializeUInt64(idJson));
+			if (it == childrenById.end()) continue;
+			m_children.push_back(std::move(it->second));
+			childrenById.erase(it);
+		}
+		for (auto& kv : childrenById)
+		{
+			outUnlisted.push_back(kv.second);
+			m_children.push_back(std::move(kv.second)); // Still ours, the caller decides what happens to them
 		}
+		reindexChildren(0);
 
-		return nullptr;
+		m_sortedChildrenDirty = true;
+		if (getScene() && getScene()->getTransformSystem()) getScene()->getTransformSystem()->markHierarchyDirty();
+		if (getScene()) getScene()->invalidateDrawList();
 	}
 
-	EntityRef Entity::findByComponent(const std::string& componentName, bool recursive)
+	void Entity::componentNameChanged()
 	{
+		rebuildComponentIndex();
+	}
+
+	bool Entity::hasComponentId(ComponentTypeId id) const
+	{
+		if (id < COMPONENT_INDEX_BITS) return (m_componentMask & (1ull << id)) != 0;
+		return getComponentById(id) != nullptr;
+	}
+
+	ComponentRef Entity::getComponentById(ComponentTypeId id) const
+	{
+		if (id < COMPONENT_INDEX_BITS)
+		{
+			auto bit = 1ull << id;
+			if (!(m_componentMask & bit)) return nullptr;
+			return m_indexedComponents[std::bitset<COMPONENT_INDEX_BITS>(m_componentMask & (bit - 1)).count()];
+		}
+
+		if (id == INVALID_COMPONENT_TYPE) return nullptr;
 		for (const auto& pComponent : m_components)
 		{
-			if (pComponent->getType() == componentName)
-				return shared_from_this();
-			auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-			if (pScriptComponent)
-			{
-				if (pScriptComponent->name == componentName)
-					return shared_from_this();
-			}
+			if (pComponent->getTypeId() == id || pComponent->getNameId() == id)
+				return pComponent;
+		}
+		return nullptr;
+	}
+
+	ComponentRef Entity::getComponentByName(const std::string& name) const
+	{
+		return getComponentById(ComponentFactory::findTypeId(name));
+	}
+
+	static bool isInSearchRadius(Entity* pEntity, const EntitySearchParams& searchParams)
+	{
+		return searchParams.radius < FLT_EPSILON || pEntity->isInRadius(searchParams.pointInWorld, searchParams.radius);
+	}
+
+	// Small buckets are cheaper to scan than the grid. Candidates from the grid still need their name/component checked.
+	static const int SPATIAL_SEARCH_MIN_BUCKET = 32;
+	static const std::vector<Entity*>& getSearchCandidates(const std::vector<Entity*>& bucket, const EntitySearchParams& searchParams, std::vector<Entity*>& scratch)
+	{
+		if (searchParams.radius < FLT_EPSILON || (int)bucket.size() <= SPATIAL_SEARCH_MIN_BUCKET) return bucket;
+		getScene()->getSpatialGrid()->queryRadius(searchParams.pointInWorld, searchParams.radius, scratch);
+		return scratch;
+	}
+
+	// Depth first, parents before children. Index buckets are unordered, this keeps recursive searches
+	// returning what walking the tree would. Both must be under the same root.
+	bool Entity::isBeforeInTree(const Entity* pA, const Entity* pB)
+	{
+		int depthA = 0;
+		int depthB = 0;
+		for (auto pEntity = pA; pEntity->m_pParent; pEntity = pEntity->m_pParent) ++depthA;
+		for (auto pEntity = pB; pEntity->m_pParent; pEntity = pEntity->m_pParent) ++depthB;
+
+		for (; depthA > depthB; --depthA)
+		{
+			pA = pA->m_pParent;
+			if (pA == pB) return false; // B is A's ancestor
+		}
+		for (; depthB > depthA; --depthB)
+		{
+			pB = pB->m_pParent;
+			if (pB == pA) return true;
 		}
+		if (pA == pB) return false;
 
-		for (auto it = m_children.begin(); it != m_children.end(); ++it)
+		while (pA->m_pParent != pB->m_pParent)
 		{
-			const EntityRef &ref = *it;
+			pA = pA->m_pParent;
+			pB = pB->m_pParent;
+		}
+		return pA->m_childIndex < pB->m_childIndex;
+	}
+
+	EntityRef Entity::getChildByName(const std::string& name, bool recursive)
+	{
+		return getChildByName(name, EntitySearchParams { }, recursive);
+	}
 
-			if (recursive)
-				if (auto found_child = ref->findByComponent(componentName, true))
-					return found_child;
+	// Recursive searches go through the scene's indexes, and only keep what's under us
+	EntityRef Entity::getChildByName(const std::string& name, const EntitySearchParams& searchParams, bool recursive)
+	{
+		if (!recursive)
+		{
+			for (const auto& pChild : m_children)
+				if (pChild->name == name && isInSearchRadius(pChild.get(), searchParams))
+					return pChild;
+			return nullptr;
 		}
 
-		return nullptr;
+		std::vector<Entity*> scratch;
+		Entity* pFound = nullptr;
+		for (auto pEntity : getSearchCandidates(getScene()->getEntitiesByName(name), searchParams, scratch))
+			if (pEntity->name == name && pEntity->isDescendantOf(this) && isInSearchRadius(pEntity, searchParams) && (!pFound || isBeforeInTree(pEntity, pFound)))
+				pFound = pEntity;
+
+		return pFound ? pFound->shared_from_this() : nullptr;
+	}
+
+	EntityRef Entity::findByComponent(const std::string& componentName, bool recursive)
+	{
+		return findByComponent(ComponentFactory::findTypeId(componentName), EntitySearchParams { }, recursive);
 	}
 
 	EntityRef Entity::findByComponent(const std::string& componentName, const EntitySearchParams& searchParams, bool recursive)
 	{
-		if (searchParams.radius < FLT_EPSILON || isInRadius(searchParams.pointInWorld, searchParams.radius))
+		return findByComponent(ComponentFactory::findTypeId(componentName), searchParams, recursive);
+	}
+
+	EntityRef Entity::findByComponent(ComponentTypeId typeId, const EntitySearchParams& searchParams, bool recursive)
+	{
+		if (typeId == INVALID_COMPONENT_TYPE) return nullptr; // Nobody ever registered that name
+
+		if (hasComponentId(typeId) && isInSearchRadius(this, searchParams))
+			return shared_from_this();
+
+		if (recursive)
 		{
-			for (const auto& pComponent : m_components)
-			{
-				if (pComponent->getType() == componentName)
-					return shared_from_this();
-				auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-				if (pScriptComponent)
-				{
-					if (pScriptComponent->name == componentName)
-						return shared_from_this();
-				}
-			}
+			std::vector<Entity*> scratch;
+			Entity* pFound = nullptr;
+			for (auto pEntity : getSearchCandidates(getScene()->getEntitiesByComponent(typeId), searchParams, scratch))
+				if (pEntity->hasComponentId(typeId) && pEntity->isDescendantOf(this) && isInSearchRadius(pEntity, searchParams) && (!pFound || isBeforeInTree(pEntity, pFound)))
+					pFound = pEntity;
+			if (pFound) return pFound->shared_from_this();
 		}
 
-		for (auto it = m_children.begin(); it != m_children.end(); ++it)
+		return nullptr;
+	}
+
+	EntityRef Entity::getChildByComponentId(ComponentTypeId typeId, const EntitySearchParams& searchParams, bool recursive)
+	{
+		if (!recursive)
 		{
-			const EntityRef &ref = *it;
+			for (const auto& pChild : m_children)
+				if (pChild->hasComponentId(typeId) && isInSearchRadius(pChild.get(), searchParams))
+					return pChild;
+			return nullptr;
+		}
+
+		std::vector<Entity*> scratch;
+		Entity* pFound = nullptr;
+		for (auto pEntity : getSearchCandidates(getScene()->getEntitiesByComponent(typeId), searchParams, scratch))
+			if (pEntity->hasComponentId(typeId) && pEntity->isDescendantOf(this) && isInSearchRadius(pEntity, searchParams) && (!pFound || isBeforeInTree(pEntity, pFound)))
+				pFound = pEntity;
+
+		return pFound ? pFound->shared_from_this() : nullptr;
+	}
 
-			if (recursive)
-				if (auto found_child = ref->findByComponent(componentName, searchParams, true))
-					return found_child;
+	void Entity::getChildrenByComponentId(ComponentTypeId typeId, std::vector<EntityRef>& outRefs, const EntitySearchParams& searchParams, bool recursive)
+	{
+		if (!recursive)
+		{
+			for (const auto& pChild : m_children)
+				if (pChild->hasComponentId(typeId) && isInSearchRadius(pChild.get(), searchParams))
+					outRefs.push_back(pChild);
+			return;
 		}
 
-		return nullptr;
+		std::vector<Entity*> scratch;
+		std::vector<Entity*> found;
+		for (auto pEntity : getSearchCandidates(getScene()->getEntitiesByComponent(typeId), searchParams, scratch))
+			if (pEntity->hasComponentId(typeId) && pEntity->isDescendantOf(this) && isInSearchRadius(pEntity, searchParams))
+				found.push_back(pEntity);
+
+		std::sort(found.begin(), found.end(), isBeforeInTree);
+		for (auto pEntity : found)
+			outRefs.push_back(pEntity->shared_from_this());
 	}
 	
 	void Entity::findByName(const std::string& in_name, std::vector<EntityRef>& entities, bool recursive)
 	{
-		if (name == in_name) entities.push_back(shared_from_this());
-
-		if (recursive)
-			for (const auto& pChild : m_children)
-				pChild->findByName(in_name, entities, true);
+		findByName(in_name, entities, EntitySearchParams { }, recursive);
 	}
 
 	void Entity::findByName(const std::string& in_name, std::vector<EntityRef>& entities, const EntitySearchParams &searchParams, bool recursive)
 	{
-		if (name == in_name && (searchParams.radius < FLT_EPSILON || isInRadius(searchParams.pointInWorld, searchParams.radius)))
+		if (name == in_name && isInSearchRadius(this, searchParams))
 			entities.push_back(shared_from_this());
 
 		if (recursive)
-			for (const auto& pChild : m_children)
-				pChild->findByName(in_name, entities, searchParams, true);
+		{
+			std::vector<Entity*> scratch;
+			std::vector<Entity*> found;
+			for (auto pEntity : getSearchCandidates(getScene()->getEntitiesByName(in_name), searchParams, scratch))
+				if (pEntity->name == in_name && pEntity->isDescendantOf(this) && isInSearchRadius(pEntity, searchParams))
+					found.push_back(pEntity);
+
+			std::sort(found.begin(), found.end(), isBeforeInTree);
+			for (auto pEntity : found)
+				entities.push_back(pEntity->shared_from_this());
+		}
 	}
 	
 	void Entity::findByComponent(const std::string& componentName, std::vector<EntityRef>& entities, bool recursive)
 	{
-		for (const auto& pComponent : m_components)
-		{
-			if (pComponent->getType() == componentName)
-			{
-				entities.push_back(shared_from_this());
-				continue;
-			}
-			auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-			if (pScriptComponent)
-			{
-				if (pScriptComponent->name == componentName)
-					entities.push_back(shared_from_this());
-			}
-		}
-
-		if (recursive)
-			for (const auto& pChild : m_children)
-				pChild->findByComponent(componentName, entities, true);
+		findByComponent(ComponentFactory::findTypeId(componentName), entities, EntitySearchParams { }, recursive);
 	}
 
 	void Entity::findByComponent(const std::string& componentName, std::vector<EntityRef>& entities, const EntitySearchParams &searchParams, bool recursive)
 	{
-		if (searchParams.radius < FLT_EPSILON || isInRadius(searchParams.pointInWorld, searchParams.radius))
-		{
-			for (const auto& pComponent : m_components)
-			{
-				if (pComponent->getType() == componentName)
-				{
-					entities.push_back(shared_from_this());
-					continue;
-				}
-				auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-				if (pScriptComponent)
-				{
-					if (pScriptComponent->name == componentName)
-						entities.push_back(shared_from_this());
-				}
-			}
-		}
+		findByComponent(ComponentFactory::findTypeId(componentName), entities, searchParams, recursive);
+	}
+
+	void Entity::findByComponent(ComponentTypeId typeId, std::vector<EntityRef>& entities, const EntitySearchParams &searchParams, bool recursive)
+	{
+		if (typeId == INVALID_COMPONENT_TYPE) return;
+
+		if (hasComponentId(typeId) && isInSearchRadius(this, searchParams))
+			entities.push_back(shared_from_this());
 
 		if (recursive)
-			for (const auto& pChild : m_children)
-				pChild->findByComponent(componentName, entities, searchParams, true);
+		{
+			std::vector<Entity*> scratch;
+			std::vector<Entity*> found;
+			for (auto pEntity : getSearchCandidates(getScene()->getEntitiesByComponent(typeId), searchParams, scratch))
+				if (pEntity->hasComponentId(typeId) && pEntity->isDescendantOf(this) && isInSearchRadius(pEntity, searchParams))
+					found.push_back(pEntity);
+
+			std::sort(found.begin(), found.end(), isBeforeInTree);
+			for (auto pEntity : found)
+				entities.push_back(pEntity->shared_from_this());
+		}
 	}
 
 	bool Entity::hasChild(const EntityRef& pChild, bool recursive) const
 	{
-		for (const auto& pMyChild : m_children)
-		{
-			if (pChild == pMyChild) return true;
-			if (recursive)
-			{
-				if (pMyChild->hasChild(pChild, recursive)) return true;
-			}
-		}
-		return false;
+		if (!pChild) return false;
+		return recursive ? pChild->isDescendantOf(this) : pChild->m_pParent == this;
 	}
 
-	Json::Value Entity::serialize(bool includeChildren)
+	// Children are left as an empty array of the right size, for serialize() to fill.
+	// Runs on worker threads, everything here only reads.
+	Json::Value Entity::serializeSelf(bool includeChildren) const
 	{
 		Json::Value json;
 
-		json["id"] = id;
-		json["enabled"] = enabled;
-		json["name"] = name;
-		json["sortChildren"] = sortChildren;
-		json["mouseChildren"] = mouseChildren;
-		json["clickThrough"] = clickThrough;
-		json["uiRoot"] = uiRoot;
-		json["lockScale"] = lockScale;
-		json["expanded"] = expanded;
-		json["editorVisible"] = editorVisible;
-		json["editorLocked"] = editorLocked;
-		json["transform"]["position"] = Utils::serializeJsonValue(m_transform.position);
-		json["transform"]["rotation"] = Utils::serializeJsonValue(m_transform.rotation);
-		json["transform"]["scale"] = Utils::serializeJsonValue(m_transform.scale);
+		SceneEntityRecord record;
+		getRecord(record);
+		writeRecord(record, json);
 
 		// Components
 		Json::Value componentsJson(Json::arrayValue);
@@ -357,14 +692,135 @@ namespace Engine
 		if (includeChildren)
 		{
 			Json::Value childrenJson(Json::arrayValue);
-			for (const auto& pChild : m_children)
-				childrenJson.append(pChild->serialize());
+			childrenJson.resize((Json::ArrayIndex)m_children.size());
 			json["children"] = childrenJson;
 		}
 
 		return json;
 	}
 
+	// The tree is flattened, every entity is serialized on its own (in parallel if there's enough),
+	// then they're nested back bottom up.
+	Json::Value Entity::serialize(bool includeChildren)
+	{
+		if (!includeChildren || m_children.empty()) return serializeSelf(includeChildren);
+
+		struct Item
+		{
+			Entity* pEntity;
+			int parent;
+			int slot; // Index in the parent's children
+		};
+
+		std::vector<Item> items;
+		std::vector<Item> stack = { { this, -1, 0 } };
+		while (!stack.empty())
+		{
+			auto item = stack.back();
+			stack.pop_back();
+
+			auto index = (int)items.size();
+			items.push_back(item);
+			const auto& children = item.pEntity->m_children;
+			for (int i = (int)children.size() - 1; i >= 0; --i)
+				stack.push_back({ children[i].get(), index, i });
+		}
+
+		std::vector<Json::Value> jsons(items.size());
+		const auto& pJobSystem = getJobSystem();
+		if (pJobSystem && (int)items.size() >= PARALLEL_SERIALIZE_MIN_ENTITIES)
+		{
+			pJobSystem->parallelFor((int)items.size(), [&](int i)
+			{
+				jsons[i] = items[i].pEntity->serializeSelf(true);
+			}, PARALLEL_SERIALIZE_BATCH_SIZE);
+		}
+		else
+		{
+			for (int i = 0; i < (int)items.size(); ++i)
+				jsons[i] = items[i].pEntity->serializeSelf(true);
+		}
+
+		// Children come after their parent, going backward they're complete when moved in
+		for (int i = (int)items.size() - 1; i > 0; --i)
+			jsons[items[i].parent]["children"][(Json::ArrayIndex)items[i].slot] = std::move(jsons[i]);
+
+		return std::move(jsons[0]);
+	}
+
+	void Entity::readRecord(const Json::Value& json, SceneEntityRecord& out)
+	{
+		out.id = Utils::deserializeUInt64(json["id"]);
+		out.name = Utils::deserializeString(json["name"]);
+		out.enabled = Utils::deserializeBool(json["enabled"], true);
+		out.sortChildren = Utils::deserializeBool(json["sortChildren"], false);
+		out.mouseChildren = Utils::deserializeBool(json["mouseChildren"], true);
+		out.clickThrough = Utils::deserializeBool(json["clickThrough"], false);
+		out.uiRoot = Utils::deserializeBool(json["uiRoot"], false);
+		out.lockScale = Utils::deserializeBool(json["lockScale"], true);
+		out.expanded = Utils::deserializeBool(json["expanded"], true);
+		out.editorVisible = Utils::deserializeBool(json["editorVisible"], true);
+		out.editorLocked = Utils::deserializeBool(json["editorLocked"], false);
+
+		out.transform.position = Utils::deserializeJsonValue<glm::vec2>(json["transform"]["position"]);
+		out.transform.rotation = Utils::deserializeFloat(json["transform"]["rotation"], 0.0f);
+		const float DEFAULT_SCALE[2] = { 1.0f, 1.0f };
+		Utils::deserializeFloat2(&out.transform.scale.x, json["transform"]["scale"], DEFAULT_SCALE);
+
+		out.componentCount = (int)json["components"].size();
+	}
+
+	void Entity::writeRecord(const SceneEntityRecord& record, Json::Value& json)
+	{
+		json["id"] = record.id;
+		json["enabled"] = record.enabled;
+		json["name"] = record.name;
+		json["sortChildren"] = record.sortChildren;
+		json["mouseChildren"] = record.mouseChildren;
+		json["clickThrough"] = record.clickThrough;
+		json["uiRoot"] = record.uiRoot;
+		json["lockScale"] = record.lockScale;
+		json["expanded"] = record.expanded;
+		json["editorVisible"] = record.editorVisible;
+		json["editorLocked"] = record.editorLocked;
+		json["transform"]["position"] = Utils::serializeJsonValue(record.transform.position);
+		json["transform"]["rotation"] = Utils::serializeJsonValue(record.transform.rotation);
+		json["transform"]["scale"] = Utils::serializeJsonValue(record.transform.scale);
+	}
+
+	// Runs on worker threads when the scene saves in parallel
+	void Entity::getRecord(SceneEntityRecord& out) const
+	{
+		out.id = id;
+		out.name = name;
+		out.transform = m_transform;
+		out.enabled = enabled;
+		out.sortChildren = sortChildren;
+		out.mouseChildren = mouseChildren;
+		out.clickThrough = clickThrough;
+		out.uiRoot = uiRoot;
+		out.lockScale = lockScale;
+		out.expanded = expanded;
+		out.editorVisible = editorVisible;
+		out.editorLocked = editorLocked;
+		out.componentCount = (int)m_components.size();
+	}
+
+	void Entity::applyRecord(const SceneEntityRecord& record)
+	{
+		setName(record.name);
+		enabled = record.enabled;
+		sortChildren = record.sortChildren;
+		mouseChildren = record.mouseChildren;
+		clickThrough = record.clickThrough;
+		uiRoot = record.uiRoot;
+		lockScale = record.lockScale;
+		expanded = record.expanded;
+		editorVisible = record.editorVisible;
+		editorLocked = record.editorLocked;
+		setTransform(record.transform);
+	}
+
 	void Entity::deserialize(const Json::Value json, bool includeChildren, bool generateNewIds)
 	{
 		for (const auto& pComponent : m_components)
@@ -372,28 +828,16 @@ namespace Engine
 			getScene()->getComponentManager()->removeComponent(pComponent);
 		}
 		m_components.clear();
+		rebuildComponentIndex();
 
-		if (generateNewIds)
-			id = getScene()->generateEntityId();
-		else
-			id = Utils::deserializeUInt64(json["id"]);
+		SceneEntityRecord record;
+		readRecord(json, record);
+
+		auto previousId = id;
+		id = generateNewIds ? getScene()->generateEntityId() : record.id;
 		getScene()->updateMaxId(id);
-		name = Utils::deserializeString(json["name"]);
-		enabled = Utils::deserializeBool(json["enabled"], true);
-		sortChildren = Utils::deserializeBool(json["sortChildren"], false);
-		mouseChildren = Utils::deserializeBool(json["mouseChildren"], true);
-		clickThrough = Utils::deserializeBool(json["clickThrough"], false);
-		uiRoot = Utils::deserializeBool(json["uiRoot"], false);
-		lockScale = Utils::deserializeBool(json["lockScale"], true);
-		expanded = Utils::deserializeBool(json["expanded"], true);
-		editorVisible = Utils::deserializeBool(json["editorVisible"], true);
-		editorLocked = Utils::deserializeBool(json["editorLocked"], false);
-
-		// Transform
-		m_transform.position = Utils::deserializeJsonValue<glm::vec2>(json["transform"]["position"]);
-		m_transform.rotation = Utils::deserializeFloat(json["transform"]["rotation"], 0.0f);
-		const float DEFAULT_SCALE[2] = { 1.0f, 1.0f };
-		Utils::deserializeFloat2(&m_transform.scale.x, json["transform"]["scale"], DEFAULT_SCALE);
+		getScene()->indexEntity(this, previousId);
+		applyRecord(record);
 
 		// Components
 		const auto& componentsJson = json["components"];
@@ -415,18 +859,21 @@ namespace Engine
 		// Children
 		if (includeChildren)
 		{
+			for (const auto& pChild : m_children)
+			{
+				pChild->m_pParent = nullptr;
+				pChild->m_childIndex = -1;
+			}
 			m_children.clear();
+			m_sortedChildrenDirty = true;
 			const auto& childrenJson = json["children"];
 			for (const auto& childJson : childrenJson)
 			{
 				getScene()->createEntityFromJson(shared_from_this(), childJson, generateNewIds);
 			}
-			m_transformDirty = true;
-		}
-		else
-		{
-			setDirtyTransform();
 		}
+
+		setDirtyTransform();
 	}
 
 	void Entity::addComponent(const ComponentRef& pComponent)
@@ -438,8 +885,7 @@ namespace Engine
 
 	glm::vec2 Entity::getWorldPosition()
 	{
-		const auto& worldTransform = getWorldTransform();
-		return worldTransform[3];
+		return getWorldTransform().translation;
 	}
 	
 	void Entity::setWorldPosition(const glm::vec2& position)
@@ -452,7 +898,7 @@ namespace Engine
 			return;
 		}
 
-		m_transform.position = m_pParent->getInvWorldTransform() * glm::vec4(position, 0, 1);
+		m_transform.position = m_pParent->getInvWorldTransform() * position;
 		setDirtyTransform();
 	}
 	
@@ -480,57 +926,82 @@ namespace Engine
 		setDirtyTransform();
 	}
 
+	// Children aren't touched, they see our world version change on the next pass or getter
 	void Entity::setDirtyTransform()
 	{
 		m_transformDirty = true;
-		for (const auto& pChild : m_children)
-			pChild->setDirtyTransform();
+		if (getScene() && getScene()->getTransformSystem()) getScene()->getTransformSystem()->markDirty();
+		markChanged();
 	}
 
-	void Entity::updateDirtyTransforms()
+	void Entity::markSpatialDirty()
 	{
-		if (!m_transformDirty) return;
+		if (getScene() && getScene()->getSpatialGrid())
+			getScene()->getSpatialGrid()->markDirty(this);
+	}
 
-		glm::mat4 localTransform = 
-			glm::translate(glm::vec3(m_transform.position, 0)) * 
-			glm::rotate(glm::radians(m_transform.rotation), glm::vec3(0, 0, 1));
+	// Parent must already be up to date. No scene access here, the transform system runs this on workers.
+	bool Entity::refreshWorldTransform()
+	{
+		auto parentVersion = m_pParent ? m_pParent->m_worldVersion : 0;
+		if (!m_transformDirty && parentVersion == m_parentVersion) return false;
+
+		auto localTransform = Transform2D::fromTRS(m_transform.position, m_transform.rotation);
 
 		if (m_pParent)
-			m_worldTransform = m_pParent->getWorldTransform() * localTransform; // This will recursively clean transforms up the tree.
+			m_worldTransform = m_pParent->m_worldTransform * localTransform;
 		else
 			m_worldTransform = localTransform;
 
-		m_worldTransformWithScale = 
-			m_worldTransform *
-			glm::scale(glm::vec3(m_transform.scale.x, m_transform.scale.y, 1));
-
-		m_invWorldTransform = glm::inverse(m_worldTransform);
-		m_invWorldTransformWithScale = glm::inverse(m_worldTransformWithScale);
+		m_worldTransformWithScale = m_worldTransform.scaled(m_transform.scale);
 
+		m_parentVersion = parentVersion;
+		++m_worldVersion;
 		m_transformDirty = false;
+		m_inverseDirty = true;
+		return true;
+	}
+
+	void Entity::updateDirtyTransforms()
+	{
+		// Common case, the transform system did a pass since anything moved
+		auto pTransformSystem = getScene() ? getScene()->getTransformSystem().get() : nullptr;
+		if (pTransformSystem && !pTransformSystem->hasPending() && m_orderStamp == pTransformSystem->getOrderStamp()) return;
+
+		if (m_pParent) m_pParent->updateDirtyTransforms();
+		if (refreshWorldTransform()) markSpatialDirty();
+	}
+
+	void Entity::updateInverseTransforms()
+	{
+		m_invWorldTransform = m_worldTransform.inverse();
+		m_invWorldTransformWithScale = m_worldTransformWithScale.inverse();
+		m_inverseDirty = false;
 	}
 	
-	const glm::mat4& Entity::getWorldTransform()
+	const Transform2D& Entity::getWorldTransform()
 	{
 		updateDirtyTransforms();
 		return m_worldTransform;
 	}
 
-	const glm::mat4& Entity::getInvWorldTransform()
+	const Transform2D& Entity::getInvWorldTransform()
 	{
 		updateDirtyTransforms();
+		if (m_inverseDirty) updateInverseTransforms();
 		return m_invWorldTransform;
 	}
 
-	const glm::mat4& Entity::getWorldTransformWithScale()
+	const Transform2D& Entity::getWorldTransformWithScale()
 	{
 		updateDirtyTransforms();
 		return m_worldTransformWithScale;
 	}
 
-	const glm::mat4& Entity::getInvWorldTransformWithScale()
+	const Transform2D& Entity::getInvWorldTransformWithScale()
 	{
 		updateDirtyTransforms();
+		if (m_inverseDirty) updateInverseTransforms();
 		return m_invWorldTransformWithScale;
 	}
 
@@ -554,17 +1025,10 @@ namespace Engine
 		{
 			if (sortChildren)
 			{
-				auto sorted = m_children;
-
-				std::sort(sorted.begin(), sorted.end(), [](const EntityRef& a, const EntityRef& b)
-				{
-					return a->getWorldPosition().y < b->getWorldPosition().y;
-				});
-
+				const auto& sorted = getSortedChildren();
 				for (auto rit = sorted.rbegin(); rit != sorted.rend(); ++rit)
 				{
-					const auto& pChild = *rit;
-					auto pRet = pChild->getMouseHover(mousePos, ignoreMouseFlags);
+					auto pRet = rit->pEntity->getMouseHover(mousePos, ignoreMouseFlags);
 					if (pRet) return pRet;
 				}
 			}
@@ -589,23 +1053,29 @@ namespace Engine
 
 	void Entity::getEntitiesInRect(std::vector<Engine::EntityRef>& entities, const glm::vec4& rect)
 	{
-		if (!editorVisible || editorLocked) return;
-		
-		if (!m_components.empty())
+		std::vector<Entity*> candidates;
+		getScene()->getSpatialGrid()->queryRect(rect, candidates);
+
+		for (auto pEntity : candidates)
 		{
-			auto pos = getWorldPosition();
-			if (pos.x >= rect.x &&
-				pos.x <= rect.x + rect.z &&
-				pos.y >= rect.y &&
-				pos.y <= rect.y + rect.w)
+			if (pEntity->m_components.empty()) continue;
+			if (!pEntity->isDescendantOf(this) && pEntity != this) continue;
+
+			// Hidden/locked entities hide their whole subtree, up to us
+			bool selectable = true;
+			for (auto pParent = pEntity; pParent; pParent = pParent->m_pParent)
 			{
-				entities.push_back(shared_from_this());
-				//return; // Don't need to select children if we select parent? (nope)
+				if (!pParent->editorVisible || pParent->editorLocked)
+				{
+					selectable = false;
+					break;
+				}
+				if (pParent == this) break;
 			}
-		}
 
-		for (const auto& pChild : m_children)
-			pChild->getEntitiesInRect(entities, rect);
+			if (selectable)
+				entities.push_back(pEntity->shared_from_this()); // Don't need to select children if we select parent? (nope)
+		}
 	}
 
 	void Entity::getVisibleEntities(std::vector<Engine::EntityRef>& entities)
@@ -695,7 +1165,12 @@ namespace Engine
 		
 		changed |= GUI::boolProperty("Enabled", &enabled);
 		GUI::idProperty("ID", id);
-		changed |= GUI::stringProperty("Name", &name);
+		auto editName = name;
+		if (GUI::stringProperty("Name", &editName))
+		{
+			setName(editName);
+			changed = true;
+		}
 		changed |= GUI::boolProperty("Sort Children", &sortChildren, "Immediate children will be sorted Top to Bottom on the Y axis.");
 		changed |= GUI::boolProperty("Mouse Children", &mouseChildren, "Allow mouse to interact with children.");
 		changed |= GUI::boolProperty("Click Through", &clickThrough, "Mouse interaction will ignore this entity, but not its children.");
@@ -781,6 +1256,7 @@ namespace Engine
 			if (moveUpIndex > 0)
 			{
 				std::swap(m_components[moveUpIndex], m_components[moveUpIndex - 1]);
+				rebuildComponentIndex();
 				changed = true;
 			}
 		}
@@ -789,6 +1265,7 @@ namespace Engine
 			if (moveDownIndex + 1 < (int)m_components.size())
 			{
 				std::swap(m_components[moveDownIndex], m_components[moveDownIndex + 1]);
+				rebuildComponentIndex();
 				changed = true;
 			}
 		}
@@ -797,21 +1274,61 @@ namespace Engine
 		return changed;
 	}
 
-	void Entity::collectUpdatables(std::vector<ComponentRef>& updatables)
+	bool Entity::isDescendantOf(const Entity* pAncestor) const
 	{
-		if (!enabled) return;
+		for (auto pEntity = m_pParent; pEntity; pEntity = pEntity->m_pParent)
+			if (pEntity == pAncestor) return true;
+		return false;
+	}
 
-		for (const auto& pComponent : m_components)
+	bool Entity::isEnabledInScene(const Entity* pRoot) const
+	{
+		auto pEntity = this;
+		while (pEntity->m_pParent)
 		{
-			if (pComponent->isEnabled())
-				updatables.push_back(pComponent);
+			if (!pEntity->enabled) return false;
+			pEntity = pEntity->m_pParent;
 		}
+		return pEntity == pRoot && pEntity->enabled;
+	}
 
-		for (const auto& pChild : m_children)
+	// Only re-reads positions of children that moved. Things mostly stay in order from one frame to
+	// the next, so insertion sort is close to linear where std::sort would redo everything.
+	const std::vector<Entity::SortedChild>& Entity::getSortedChildren()
+	{
+		if (m_sortedChildrenDirty)
+		{
+			m_sortedChildren.clear();
+			for (const auto& pChild : m_children)
+				m_sortedChildren.push_back({ pChild.get(), pChild->getWorldPosition().y, pChild->m_worldVersion });
+			m_sortedChildrenDirty = false;
+		}
+		else
 		{
-			if (pChild->enabled)
-				pChild->collectUpdatables(updatables);
+			bool moved = false;
+			for (auto& sortedChild : m_sortedChildren)
+			{
+				auto pChild = sortedChild.pEntity;
+				pChild->updateDirtyTransforms();
+				if (pChild->m_worldVersion == sortedChild.worldVersion) continue;
+
+				sortedChild.y = pChild->getWorldPosition().y;
+				sortedChild.worldVersion = pChild->m_worldVersion;
+				moved = true;
+			}
+			if (!moved) return m_sortedChildren;
+		}
+
+		for (int i = 1; i < (int)m_sortedChildren.size(); ++i)
+		{
+			auto sortedChild = m_sortedChildren[i];
+			int j = i - 1;
+			for (; j >= 0 && m_sortedChildren[j].y > sortedChild.y; --j)
+				m_sortedChildren[j + 1] = m_sortedChildren[j];
+			m_sortedChildren[j + 1] = sortedChild;
 		}
+
+		return m_sortedChildren;
 	}
 
 	void Entity::draw()
@@ -828,15 +1345,9 @@ namespace Engine
 
 		if (sortChildren)
 		{
-			auto sorted = m_children;
-
-			std::sort(sorted.begin(), sorted.end(), [](const EntityRef& a, const EntityRef& b)
-			{
-				return a->getWorldPosition().y < b->getWorldPosition().y;
-			});
-
-			for (const auto& pChild : sorted)
+			for (const auto& sortedChild : getSortedChildren())
 			{
+				auto pChild = sortedChild.pEntity;
 				if (pChild->enabled || isEditor)
 					pChild->draw();
 			}
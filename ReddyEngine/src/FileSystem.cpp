@@ -0,0 +1,535 @@
+#if defined(WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "Engine/FileSystem.h"
+#include "Engine/Log.h"
+#include "Engine/ResourceId.h"
+#include "Engine/Utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <set>
+
+
+static const char PACK_MAGIC[4] = { 'R', 'P', 'A', 'K' };
+static const uint32_t PACK_VERSION = 1;
+static const uint32_t PACK_ENTRY_COMPRESSED = 1;
+static const size_t PACK_DATA_ALIGNMENT = 16;
+
+
+namespace Engine
+{
+    namespace FileSystem
+    {
+        // Layout: PackHeader | entry data... | names (zero terminated) | PackEntry[entryCount] sorted by hash
+#pragma pack(push, 1)
+        struct PackHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t entryCount;
+            uint32_t reserved;
+            uint64_t indexOffset;
+            uint64_t namesOffset;
+        };
+
+        struct PackEntry
+        {
+            uint64_t hash;
+            uint64_t offset;
+            uint32_t size; // Stored size
+            uint32_t originalSize;
+            uint32_t nameOffset; // Relative to namesOffset
+            uint32_t flags;
+        };
+#pragma pack(pop)
+
+
+        //--- LZ4 block format. We only need the block format, no frames.
+
+        static void writeLZ4Length(std::vector<uint8_t>& out, size_t len)
+        {
+            while (len >= 255)
+            {
+                out.push_back(255);
+                len -= 255;
+            }
+            out.push_back((uint8_t)len);
+        }
+
+        static void writeLZ4Sequence(std::vector<uint8_t>& out, const uint8_t* pLiterals, size_t literalCount, size_t offset, size_t matchLen)
+        {
+            auto matchCode = matchLen ? matchLen - 4 : 0;
+            out.push_back((uint8_t)((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15)));
+            if (literalCount >= 15) writeLZ4Length(out, literalCount - 15);
+            out.insert(out.end(), pLiterals, pLiterals + literalCount);
+            if (!matchLen) return; // Last sequence is literals only
+
+            out.push_back((uint8_t)(offset & 0xFF));
+            out.push_back((uint8_t)(offset >> 8));
+            if (matchCode >= 15) writeLZ4Length(out, matchCode - 15);
+        }
+
+        // Greedy single probe compressor. Not the best ratio, but it's only run when building packs.
+        static std::vector<uint8_t> compressLZ4(const uint8_t* pSrc, size_t srcSize)
+        {
+            static const int HASH_BITS = 14;
+            static const size_t MIN_INPUT = 13; // Spec: last match starts 12 bytes before the end, last 5 bytes are literals
+
+            std::vector<uint8_t> out;
+            out.reserve(srcSize + srcSize / 255 + 16);
+
+            size_t anchor = 0;
+            if (srcSize >= MIN_INPUT)
+            {
+                std::vector<int64_t> table(1 << HASH_BITS, -1);
+                auto read32 = [pSrc](size_t pos) { uint32_t v; memcpy(&v, pSrc + pos, 4); return v; };
+
+                size_t matchStartLimit = srcSize - 12;
+                size_t matchEndLimit = srcSize - 5;
+                size_t i = 0;
+                while (i < matchStartLimit)
+                {
+                    auto seq = read32(i);
+                    auto h = (seq * 2654435761u) >> (32 - HASH_BITS);
+                    auto ref = table[h];
+                    table[h] = (int64_t)i;
+
+                    if (ref < 0 || i - (size_t)ref > 65535 || read32((size_t)ref) != seq)
+                    {
+                        ++i;
+                        continue;
+                    }
+
+                    size_t len = 4;
+                    while (i + len < matchEndLimit && pSrc[(size_t)ref + len] == pSrc[i + len]) ++len;
+
+                    writeLZ4Sequence(out, pSrc + anchor, i - anchor, i - (size_t)ref, len);
+                    i += len;
+                    anchor = i;
+                }
+            }
+
+            writeLZ4Sequence(out, pSrc + anchor, srcSize - anchor, 0, 0);
+            return out;
+        }
+
+        static bool decompressLZ4(const uint8_t* pSrc, size_t srcSize, uint8_t* pDst, size_t dstSize)
+        {
+            auto ip = pSrc;
+            auto iend = pSrc + srcSize;
+            auto op = pDst;
+            auto oend = pDst + dstSize;
+
+            auto readLength = [&](size_t& len) -> bool
+            {
+                uint8_t b;
+                do
+                {
+                    if (ip >= iend) return false;
+                    b = *ip++;
+                    len += b;
+                } while (b == 255);
+                return true;
+            };
+
+            while (ip < iend)
+            {
+                auto token = *ip++;
+
+                size_t literalCount = token >> 4;
+                if (literalCount == 15 && !readLength(literalCount)) return false;
+                if (literalCount > (size_t)(iend - ip) || literalCount > (size_t)(oend - op)) return false;
+                memcpy(op, ip, literalCount);
+                op += literalCount;
+                ip += literalCount;
+
+                if (ip >= iend) break; // Last sequence
+
+                if (iend - ip < 2) return false;
+                size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+                ip += 2;
+                if (offset == 0 || offset > (size_t)(op - pDst)) return false;
+
+                size_t matchLen = token & 15;
+                if (matchLen == 15 && !readLength(matchLen)) return false;
+                matchLen += 4;
+                if (matchLen > (size_t)(oend - op)) return false;
+
+                // Matches can overlap the output, copy byte per byte
+                auto pMatch = op - offset;
+                for (size_t i = 0; i < matchLen; ++i) *op++ = *pMatch++;
+            }
+
+            return op == oend;
+        }
+
+
+        //--- Pack
+
+        class Pack
+        {
+        public:
+            ~Pack()
+            {
+#if defined(WIN32)
+                if (m_pData) UnmapViewOfFile(m_pData);
+                if (m_hMapping) CloseHandle(m_hMapping);
+                if (m_hFile != INVALID_HANDLE_VALUE) CloseHandle(m_hFile);
+#else
+                if (m_pData) munmap((void*)m_pData, m_size);
+#endif
+            }
+
+            bool open(const std::string& filename)
+            {
+                m_filename = filename;
+
+#if defined(WIN32)
+                m_hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+                if (m_hFile == INVALID_HANDLE_VALUE) return false;
+                LARGE_INTEGER fileSize;
+                if (!GetFileSizeEx(m_hFile, &fileSize)) return false;
+                m_size = (size_t)fileSize.QuadPart;
+                m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+                if (!m_hMapping) return false;
+                m_pData = (const uint8_t*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+                int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd < 0) return false;
+                struct stat st;
+                if (fstat(fd, &st) != 0)
+                {
+                    ::close(fd);
+                    return false;
+                }
+                m_size = (size_t)st.st_size;
+                auto pMapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd); // The mapping keeps the file alive
+                m_pData = pMapped == MAP_FAILED ? nullptr : (const uint8_t*)pMapped;
+#endif
+                if (!m_pData) return false;
+
+                if (m_size < sizeof(PackHeader)) return false;
+                memcpy(&m_header, m_pData, sizeof(PackHeader));
+                if (memcmp(m_header.magic, PACK_MAGIC, 4) != 0 || m_header.version != PACK_VERSION)
+                {
+                    CORE_ERROR("Invalid pack header: {}", filename);
+                    return false;
+                }
+                if (m_header.indexOffset + (uint64_t)m_header.entryCount * sizeof(PackEntry) > m_size ||
+                    m_header.namesOffset > m_header.indexOffset)
+                {
+                    CORE_ERROR("Corrupted pack index: {}", filename);
+                    return false;
+                }
+
+                m_pEntries = (const PackEntry*)(m_pData + m_header.indexOffset);
+                return true;
+            }
+
+            const PackEntry* find(uint64_t hash) const
+            {
+                auto pEnd = m_pEntries + m_header.entryCount;
+                auto it = std::lower_bound(m_pEntries, pEnd, hash, [](const PackEntry& entry, uint64_t h) { return entry.hash < h; });
+                if (it == pEnd || it->hash != hash) return nullptr;
+                return it;
+            }
+
+            bool read(const PackEntry* pEntry, FileData& out) const
+            {
+                if (pEntry->offset + pEntry->size > m_header.namesOffset)
+                {
+                    CORE_ERROR("Corrupted pack entry in: {}", m_filename);
+                    return false;
+                }
+
+                auto pSrc = m_pData + pEntry->offset;
+                if (!(pEntry->flags & PACK_ENTRY_COMPRESSED))
+                {
+                    out.storage.clear();
+                    out.pData = pSrc;
+                    out.size = pEntry->size;
+                    return true;
+                }
+
+                out.storage.resize(pEntry->originalSize);
+                if (!decompressLZ4(pSrc, pEntry->size, out.storage.data(), out.storage.size()))
+                {
+                    CORE_ERROR("Failed to decompress entry from: {}", m_filename);
+                    return false;
+                }
+                out.pData = out.storage.data();
+                out.size = out.storage.size();
+                return true;
+            }
+
+            void collectNames(std::vector<std::string>& out) const
+            {
+                auto pNames = (const char*)(m_pData + m_header.namesOffset);
+                for (uint32_t i = 0; i < m_header.entryCount; ++i)
+                    out.push_back(pNames + m_pEntries[i].nameOffset);
+            }
+
+        private:
+            std::string m_filename;
+            const uint8_t* m_pData = nullptr;
+            size_t m_size = 0;
+            PackHeader m_header;
+            const PackEntry* m_pEntries = nullptr;
+#if defined(WIN32)
+            HANDLE m_hFile = INVALID_HANDLE_VALUE;
+            HANDLE m_hMapping = NULL;
+#endif
+        };
+
+        static std::vector<std::unique_ptr<Pack>> s_packs;
+
+
+        //--- Helpers
+
+        static std::string normalizePath(const std::string& filename)
+        {
+            std::string ret;
+            ret.reserve(filename.size());
+            for (auto c : filename)
+            {
+                if (c == '\\') c = '/';
+                if (c == '/' && !ret.empty() && ret.back() == '/') continue;
+                ret.push_back(c);
+            }
+            while (ret.size() >= 2 && ret[0] == '.' && ret[1] == '/') ret.erase(0, 2);
+            return ret;
+        }
+
+        uint64_t hashPath(const std::string& filename)
+        {
+            auto normalized = normalizePath(filename);
+            return hashPathChars(normalized.c_str(), normalized.size());
+        }
+
+        static bool readLooseFile(const std::string& filename, FileData& out)
+        {
+            std::ifstream file(filename, std::ios::binary | std::ios::ate);
+            if (!file.is_open()) return false;
+
+            auto size = (size_t)file.tellg();
+            file.seekg(0, std::ios::beg);
+            out.storage.resize(size);
+            if (size && !file.read((char*)out.storage.data(), size)) return false;
+
+            out.pData = out.storage.data();
+            out.size = size;
+            return true;
+        }
+
+
+        //--- Public
+
+        FileData::FileData(FileData&& other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        FileData& FileData::operator=(FileData&& other) noexcept
+        {
+            bool ownsData = other.pData && other.pData == other.storage.data();
+            storage = std::move(other.storage);
+            pData = ownsData ? storage.data() : other.pData;
+            size = other.size;
+            other.pData = nullptr;
+            other.size = 0;
+            return *this;
+        }
+
+        bool mountPack(const std::string& filename)
+        {
+            auto pPack = std::make_unique<Pack>();
+            if (!pPack->open(filename))
+            {
+                CORE_ERROR("Failed to mount pack: {}", filename);
+                return false;
+            }
+            s_packs.push_back(std::move(pPack));
+            CORE_INFO("Mounted pack: {}", filename);
+            return true;
+        }
+
+        void unmountPacks()
+        {
+            s_packs.clear();
+        }
+
+        bool readFile(const std::string& filename, FileData& out)
+        {
+            if (!s_packs.empty())
+            {
+                auto hash = hashPath(filename);
+                for (auto it = s_packs.rbegin(); it != s_packs.rend(); ++it)
+                {
+                    auto pEntry = (*it)->find(hash);
+                    if (pEntry) return (*it)->read(pEntry, out);
+                }
+            }
+
+            return readLooseFile(filename, out);
+        }
+
+        bool fileExists(const std::string& filename)
+        {
+            if (!s_packs.empty())
+            {
+                auto hash = hashPath(filename);
+                for (const auto& pPack : s_packs)
+                    if (pPack->find(hash)) return true;
+            }
+
+            return Utils::fileExists(filename);
+        }
+
+        std::vector<std::string> findAllFiles(const std::string& lookIn, const std::string& extension)
+        {
+            std::vector<std::string> ret;
+            std::set<uint64_t> found;
+
+            bool all = extension == "*";
+            auto upExt = Utils::toUpper(extension);
+            auto prefix = Utils::toLower(normalizePath(lookIn));
+            if (!prefix.empty() && prefix.back() != '/') prefix.push_back('/');
+
+            std::vector<std::string> names;
+            for (const auto& pPack : s_packs) pPack->collectNames(names);
+            for (const auto& name : names)
+            {
+                if (Utils::toLower(name).compare(0, prefix.size(), prefix) != 0) continue;
+                if (!all && Utils::toUpper(Utils::getExtension(name)) != upExt) continue;
+                if (found.insert(hashPath(name)).second) ret.push_back(name);
+            }
+
+            // Loose files can add to, but not override, what's in the packs
+            for (const auto& name : Utils::findAllFiles(lookIn, extension, true))
+            {
+                if (found.insert(hashPath(name)).second) ret.push_back(name);
+            }
+
+            return ret;
+        }
+
+        bool buildPack(const std::string& folder, const std::string& packFilename, bool compress, const CookFn& cookFn)
+        {
+            struct PendingEntry
+            {
+                std::string name;
+                PackEntry entry;
+            };
+
+            auto files = Utils::findAllFiles(folder, "*", true);
+            std::sort(files.begin(), files.end());
+
+            std::ofstream out(packFilename, std::ios::binary);
+            if (!out.is_open())
+            {
+                CORE_ERROR("Failed to create pack: {}", packFilename);
+                return false;
+            }
+
+            PackHeader header = {};
+            memcpy(header.magic, PACK_MAGIC, 4);
+            header.version = PACK_VERSION;
+            out.write((const char*)&header, sizeof(header));
+
+            std::vector<PendingEntry> pending;
+            std::string names;
+            uint64_t offset = sizeof(header);
+            auto writeEntry = [&](const std::string& file, const uint8_t* pData, size_t size)
+            {
+                // Pad so uncompressed entries handed out zero-copy are aligned
+                while (offset % PACK_DATA_ALIGNMENT)
+                {
+                    out.put(0);
+                    ++offset;
+                }
+
+                PendingEntry pendingEntry;
+                pendingEntry.name = normalizePath(file);
+                pendingEntry.entry.hash = hashPath(file);
+                pendingEntry.entry.offset = offset;
+                pendingEntry.entry.originalSize = (uint32_t)size;
+                pendingEntry.entry.nameOffset = (uint32_t)names.size();
+                pendingEntry.entry.flags = 0;
+
+                // Only keep compression if it's worth it. Already compressed formats (png, ogg) won't be.
+                std::vector<uint8_t> compressed;
+                if (compress && size) compressed = compressLZ4(pData, size);
+                if (!compressed.empty() && compressed.size() < size - size / 8)
+                {
+                    pendingEntry.entry.flags |= PACK_ENTRY_COMPRESSED;
+                    pendingEntry.entry.size = (uint32_t)compressed.size();
+                    out.write((const char*)compressed.data(), compressed.size());
+                }
+                else
+                {
+                    pendingEntry.entry.size = (uint32_t)size;
+                    out.write((const char*)pData, size);
+                }
+                offset += pendingEntry.entry.size;
+
+                names += pendingEntry.name;
+                names.push_back('\0');
+                pending.push_back(pendingEntry);
+            };
+
+            for (const auto& file : files)
+            {
+                FileData data;
+                if (!readLooseFile(file, data))
+                {
+                    CORE_ERROR("Failed to read file for pack: {}", file);
+                    return false;
+                }
+                writeEntry(file, data.pData, data.size);
+
+                if (cookFn)
+                {
+                    std::vector<CookedFile> cookedFiles;
+                    cookFn(file, data, cookedFiles);
+                    for (const auto& cookedFile : cookedFiles)
+                        writeEntry(cookedFile.filename, cookedFile.data.data(), cookedFile.data.size());
+                }
+            }
+
+            header.namesOffset = offset;
+            out.write(names.data(), names.size());
+            offset += names.size();
+
+            std::sort(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) { return a.entry.hash < b.entry.hash; });
+            for (size_t i = 1; i < pending.size(); ++i)
+            {
+                if (pending[i].entry.hash == pending[i - 1].entry.hash)
+                {
+                    CORE_ERROR("Hash collision in pack between {} and {}", pending[i - 1].name, pending[i].name);
+                    return false;
+                }
+            }
+
+            header.indexOffset = offset;
+            header.entryCount = (uint32_t)pending.size();
+            for (const auto& pendingEntry : pending)
+                out.write((const char*)&pendingEntry.entry, sizeof(PackEntry));
+
+            out.seekp(0, std::ios::beg);
+            out.write((const char*)&header, sizeof(header));
+            out.close();
+
+            CORE_INFO("Built pack {} with {} files", packFilename, pending.size());
+            return true;
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "Engine/Font.h"
+#include "Engine/FileSystem.h"
 #include "Engine/Log.h"
 #include "Engine/ReddyEngine.h"
 #include "Engine/SpriteBatch.h"
@@ -33,22 +34,16 @@ namespace Engine
         pRet->m_shadowDistance = Utils::deserializeInt32(json["shadowDistance"], 2);
         
         // load font file
-        long size;
-    
         auto fontFilename = "assets/" + json["file"].asString();
-        FILE* fontFile = fopen(fontFilename.c_str(), "rb");
-        if (!fontFile)
+        FileSystem::FileData fontFile;
+        if (!FileSystem::readFile(fontFilename, fontFile))
         {
             CORE_ERROR("Failed to load Font: {}", fontFilename.c_str());
             return nullptr;
         }
 
-        fseek(fontFile, 0, SEEK_END);
-        size = ftell(fontFile); 
-        fseek(fontFile, 0, SEEK_SET);
-        pRet->m_pFontData = new uint8_t[size];
-        fread(pRet->m_pFontData, 1, size, fontFile);
-        fclose(fontFile);
+        pRet->m_pFontData = new uint8_t[fontFile.size];
+        memcpy(pRet->m_pFontData, fontFile.pData, fontFile.size);
 
         // Create dynamic texture where we will put in the glyphs
         pRet->m_pAtlas = Texture::createDynamic({ATLAS_SIZE, ATLAS_SIZE});
@@ -281,15 +276,6 @@ namespace Engine
         return size;
     }
     
-    //void Font::draw(const std::string& text,
-    //                const glm::mat4& transform, 
-    //                const glm::vec4& color,
-    //                float scale,
-    //                const glm::vec2& align)
-    //{
-    //    // no op
-    //}
-
     void Font::draw(const std::string& text,
                     const glm::vec2& position, 
                     const glm::vec4& color,
@@ -297,23 +283,29 @@ namespace Engine
                     float scale,
                     const glm::vec2& align,
                     float justify)
+    {
+        draw(text, Transform2D::fromTRS(position, rotation), color, scale, align, justify);
+    }
+
+    void Font::draw(const std::string& text,
+                    const Transform2D& transform, 
+                    const glm::vec4& color,
+                    float scale,
+                    const glm::vec2& align,
+                    float justify)
     {
         auto sb = Engine::getSpriteBatch().get();
 
         bool atlasModified = false;
 
         auto size = measure(text);
-        auto hSize = size * 0.5f;
 
-        auto radTheta = glm::radians(rotation);
-        auto sinTheta = std::sin(radTheta);
-        auto cosTheta = std::cos(radTheta);
-        glm::vec2 right{cosTheta, sinTheta};
-        glm::vec2 down{-sinTheta, cosTheta};
+        const auto& right = transform.xAxis;
+        const auto& down = transform.yAxis;
         auto downN = glm::normalize(down);
 
         // Top left
-        glm::vec2 topLeft = position - (right * size.x * align.x * scale) - (down * size.y * align.y * scale);
+        glm::vec2 topLeft = transform.translation - (right * size.x * align.x * scale) - (down * size.y * align.y * scale);
         glm::vec2 pos = topLeft;
         int line = 0;
 
@@ -353,7 +345,9 @@ namespace Engine
             glm::vec2 offset = 
                 chr->offset.x * right * scale + 
                 chr->offset.y * down * scale;
-            sb->drawSprite(m_pAtlas, pos + offset, color, rotation, glm::vec2(scale), {0.0f, 0.0f}, chr->uvs);
+            auto glyphTransform = transform;
+            glyphTransform.translation = pos + offset;
+            sb->drawSprite(m_pAtlas, glyphTransform, color, glm::vec2(scale), {0.0f, 0.0f}, chr->uvs);
 
             // Advance
             float xAdvance = chr->xAdvance;
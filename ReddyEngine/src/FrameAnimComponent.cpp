@@ -142,7 +142,7 @@ namespace Engine
         glm::vec2 sizef = glm::vec2((float)textureSize.x, (float)textureSize.y) * m_pEntity->getTransform().scale * SPRITE_BASE_SCALE;
         glm::vec2 invOrigin(1.f - origin.x, 1.f - origin.y);
 
-        glm::vec2 localMouse = invTransform * glm::vec4(mousePos, 0, 1);
+        glm::vec2 localMouse = invTransform * mousePos;
 
         return 
             localMouse.x >= -sizef.x * origin.x &&
@@ -163,10 +163,10 @@ namespace Engine
         glm::vec2 invOrigin(1.f - origin.x, 1.f - origin.y);
 
         glm::vec2 points[4] = {
-            transform * glm::vec4(-sizef.x * origin.x, -sizef.y * origin.y, 0, 1),
-            transform * glm::vec4(-sizef.x * origin.x, sizef.y * invOrigin.y, 0, 1),
-            transform * glm::vec4(sizef.x * invOrigin.x, sizef.y * invOrigin.y, 0, 1),
-            transform * glm::vec4(sizef.x * invOrigin.x, -sizef.y * origin.y, 0, 1)
+            transform * glm::vec2(-sizef.x * origin.x, -sizef.y * origin.y),
+            transform * glm::vec2(-sizef.x * origin.x, sizef.y * invOrigin.y),
+            transform * glm::vec2(sizef.x * invOrigin.x, sizef.y * invOrigin.y),
+            transform * glm::vec2(sizef.x * invOrigin.x, -sizef.y * origin.y)
         };
 
 		sb->drawLine(points[0], points[1], 2.0f * zoomScale, color);
@@ -262,7 +262,12 @@ namespace Engine
             return false;
         }
 
-        const auto& anim = m_frameAnim->animationSet[m_currentAnimation];
+        // find, operator[] would insert into the shared asset from worker threads
+        auto it = m_frameAnim->animationSet.find(m_currentAnimation);
+        if (it == m_frameAnim->animationSet.end()) {
+            return false;
+        }
+        const auto& anim = it->second;
 
         if (anim.frames.empty()) {
             return false;
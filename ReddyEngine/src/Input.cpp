@@ -1,5 +1,6 @@
 #include "Engine/Input.h"
 
+#include "Engine/FileSystem.h"
 #include "Engine/Texture.h"
 #include "imgui.h"
 #include <stb_image.h>
@@ -114,8 +115,11 @@ namespace Engine
 
         if (m_cursors[path] == nullptr)
         {
-            int pSizeX, pSizeY, channels;
-            auto cursorImg = stbi_load(path.c_str(), &pSizeX, &pSizeY, &channels, 4);
+            int pSizeX = 0, pSizeY = 0, channels;
+            FileSystem::FileData fileData;
+            stbi_uc* cursorImg = nullptr;
+            if (FileSystem::readFile(path, fileData))
+                cursorImg = stbi_load_from_memory(fileData.pData, (int)fileData.size, &pSizeX, &pSizeY, &channels, 4);
             
 
 			auto pSurface = SDL_CreateRGBSurfaceFrom(cursorImg,
@@ -0,0 +1,108 @@
+#include "Engine/JobSystem.h"
+
+#include <algorithm>
+
+
+namespace Engine
+{
+    JobSystem::JobSystem(int workerCount)
+    {
+        if (workerCount < 0) workerCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+
+        for (int i = 0; i < workerCount; ++i)
+            m_workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers) worker.join();
+    }
+
+    void JobSystem::schedule(const Job& job, JobCounter* pCounter)
+    {
+        if (pCounter) ++pCounter->pending;
+
+        if (m_workers.empty())
+        {
+            job();
+            if (pCounter) --pCounter->pending;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back({ job, pCounter });
+        }
+        m_condition.notify_one();
+    }
+
+    void JobSystem::wait(JobCounter& counter)
+    {
+        while (!counter.isDone())
+        {
+            if (!runOneJob()) std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::parallelFor(int count, const std::function<void(int)>& fn, int batchSize)
+    {
+        if (count <= 0) return;
+        batchSize = std::max(1, batchSize);
+
+        if (m_workers.empty() || count <= batchSize)
+        {
+            for (int i = 0; i < count; ++i) fn(i);
+            return;
+        }
+
+        JobCounter counter;
+        for (int begin = 0; begin < count; begin += batchSize)
+        {
+            int end = std::min(count, begin + batchSize);
+            schedule([&fn, begin, end]()
+            {
+                for (int i = begin; i < end; ++i) fn(i);
+            }, &counter);
+        }
+        wait(counter);
+    }
+
+    bool JobSystem::runOneJob()
+    {
+        QueuedJob queuedJob;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_jobs.empty()) return false;
+            queuedJob = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        queuedJob.job();
+        if (queuedJob.pCounter) --queuedJob.pCounter->pending;
+        return true;
+    }
+
+    void JobSystem::workerLoop()
+    {
+        while (true)
+        {
+            QueuedJob queuedJob;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+                if (m_stop && m_jobs.empty()) return;
+                queuedJob = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            queuedJob.job();
+            if (queuedJob.pCounter) --queuedJob.pCounter->pending;
+        }
+    }
+}
@@ -5,6 +5,7 @@ extern "C" {
 }
 
 #include "Engine/LuaBindings.h"
+#include "Engine/FileSystem.h"
 #include "Engine/Log.h"
 #include "Engine/Utils.h"
 #include "Engine/ScriptComponent.h"
@@ -245,7 +246,7 @@ namespace Engine
 
     void LuaBindings::runFiles()
     {
-        auto luaFiles = Utils::findAllFiles("assets/scripts", "LUA", true);
+        auto luaFiles = FileSystem::findAllFiles("assets/scripts", "LUA");
 
         // Put core.lua first, as other files will refer to it
         for (auto it = luaFiles.begin(); it != luaFiles.end(); ++it)
@@ -261,7 +262,18 @@ namespace Engine
 
         // Run them
         for (const auto& luaFile : luaFiles)
-            checkLua(L, luaL_dofile(L, luaFile.c_str()));
+        {
+            FileSystem::FileData fileData;
+            if (!FileSystem::readFile(luaFile, fileData))
+            {
+                CORE_ERROR("Failed to load script: {}", luaFile);
+                continue;
+            }
+
+            auto chunkName = "@" + luaFile; // So errors still report the file name
+            if (checkLua(L, luaL_loadbuffer(L, (const char*)fileData.pData, fileData.size, chunkName.c_str())))
+                checkLua(L, lua_pcall(L, 0, LUA_MULTRET, 0));
+        }
     }
     
     LuaComponentDef* LuaBindings::getComponentDef(const std::string& name) const
@@ -333,16 +345,27 @@ std::string LUA_GET_STRING_impl(lua_State* L, int stackIndex, const std::string&
     return defaultValue;
 }
 
-Engine::EntityRef LUA_GET_ENTITY_impl(lua_State* L, int stackIndex, const char* funcName)
+Engine::ResourceId LUA_GET_RESOURCE_ID_impl(lua_State* L, int stackIndex, const Engine::ResourceId& defaultValue)
+{
+    // Points to Lua's string, no copy. ResourceManager interns it if it ends up being stored.
+    if (lua_gettop(L) >= stackIndex && lua_isstring(L, stackIndex))
+        return Engine::ResourceId(lua_tostring(L, stackIndex));
+    return defaultValue;
+}
+
+// EOBJ/COBJ hold handles, so entities and components destroyed since the table was made resolve to nullptr
+Engine::Entity* LUA_GET_ENTITY_RAW_impl(lua_State* L, int stackIndex, const char* funcName)
 {
     if (lua_gettop(L) < stackIndex) return nullptr;
-    if (lua_isstring(L, stackIndex)) return Engine::getScene()->getEntityByName(lua_tostring(L, stackIndex), true);
+    if (lua_isstring(L, stackIndex)) return Engine::getScene()->getEntityByName(lua_tostring(L, stackIndex), true).get();
     if (!lua_istable(L, stackIndex)) return nullptr;
 
+    const auto& pScene = Engine::getScene();
+
     lua_getfield(L, stackIndex, "EOBJ");
     if (lua_islightuserdata(L, -1))
     {
-        auto pEntity = ((Engine::Entity*)lua_topointer(L, -1))->shared_from_this();
+        auto pEntity = pScene->getEntity(Engine::EntityHandle::fromUserData(lua_touserdata(L, -1)));
         lua_pop(L, 1);
         return pEntity;
     }
@@ -355,9 +378,15 @@ Engine::EntityRef LUA_GET_ENTITY_impl(lua_State* L, int stackIndex, const char*
         return nullptr;
     }
 
-    auto pScriptComponent = (Engine::ScriptComponent*)lua_topointer(L, -1);
+    auto pComponent = pScene->getComponent(Engine::ComponentHandle::fromUserData(lua_touserdata(L, -1)));
     lua_pop(L, 1);
-    return pScriptComponent->getEntity();
+    return pComponent ? pComponent->getEntityRaw() : nullptr;
+}
+
+Engine::EntityRef LUA_GET_ENTITY_impl(lua_State* L, int stackIndex, const char* funcName)
+{
+    auto pEntity = LUA_GET_ENTITY_RAW_impl(L, stackIndex, funcName);
+    return pEntity ? pEntity->shared_from_this() : nullptr;
 }
 
 Engine::ScriptComponent* LUA_GET_SCRIPT_COMPONENT_impl(lua_State* L, int stackIndex, const char* funcName)
@@ -368,7 +397,7 @@ Engine::ScriptComponent* LUA_GET_SCRIPT_COMPONENT_impl(lua_State* L, int stackIn
         CORE_ERROR_POPUP("Lua: {} Argument at {} should be a ScriptComponent.", funcName, stackIndex);
         return nullptr;
     }
-    auto pScriptComponent = (Engine::ScriptComponent*)lua_topointer(L, -1);
+    auto pComponent = Engine::getScene()->getComponent(Engine::ComponentHandle::fromUserData(lua_touserdata(L, -1)));
     lua_pop(L, 1);
-    return pScriptComponent;
+    return static_cast<Engine::ScriptComponent*>(pComponent); // Only script components have a COBJ
 }
@@ -21,6 +21,7 @@ extern "C" {
 #include "Engine/TextComponent.h"
 #include "Engine/MusicManager.h"
 #include "Engine/Config.h"
+#include "Engine/Prefab.h"
 
 
 namespace Engine
@@ -45,6 +46,7 @@ namespace Engine
         LUA_REGISTER(GetParent);
         LUA_REGISTER(AddChild);
         LUA_REGISTER(CreateEntity);
+        LUA_REGISTER(CreateEntities);
         LUA_REGISTER(Destroy);
         LUA_REGISTER(AddComponent);
         LUA_REGISTER(RemoveComponent);
@@ -92,6 +94,7 @@ namespace Engine
         LUA_REGISTER(FindEntityByComponent);
         LUA_REGISTER(FindEntitiesByName);
         LUA_REGISTER(FindEntitiesByComponent);
+        LUA_REGISTER(FindEntitiesWithComponents);
         LUA_REGISTER(ContinueGame);
         LUA_REGISTER(NewGame);
         LUA_REGISTER(Quit);
@@ -112,6 +115,7 @@ namespace Engine
         LUA_REGISTER(DisableEntity);
         LUA_REGISTER(EnableComponent);
         LUA_REGISTER(DisableComponent);
+        LUA_REGISTER(SetTickPolicy);
         LUA_REGISTER(GetConfig);
         LUA_REGISTER(SetConfig);
     }
@@ -134,6 +138,7 @@ namespace Engine
         lua_setglobal(L, pComponentDef->luaName.c_str());
 
         m_componentDefs[name] = pComponentDef;
+        ComponentFactory::internName(name); // So FindByComponent/GetComponent can resolve it before any instance exists
 
         return 0;
     }
@@ -306,25 +311,19 @@ namespace Engine
 
     int LuaBindings::funcGetComponent(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (pEntity)
         {
             auto scriptComponentName = LUA_GET_STRING(2, "");
             if (!scriptComponentName.empty())
             {
-                auto pComponents = pEntity->getComponents();
-                for (const auto& pComponent : pComponents)
+                auto pComponent = pEntity->getComponentByName(scriptComponentName);
+                if (pComponent && pComponent->getNameId() != pComponent->getTypeId()) // Only named scripts have a Lua object
                 {
-                    auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-                    if (pScriptComponent)
-                    {
-                        if (pScriptComponent->name == scriptComponentName)
-                        {
-                            lua_getglobal(L, "CINS_t");
-                            lua_getfield(L, -1, pScriptComponent->luaName.c_str());
-                            return 1;
-                        }
-                    }
+                    auto pScriptComponent = std::static_pointer_cast<ScriptComponent>(pComponent);
+                    lua_getglobal(L, "CINS_t");
+                    lua_getfield(L, -1, pScriptComponent->luaName.c_str());
+                    return 1;
                 }
             }
         }
@@ -334,7 +333,7 @@ namespace Engine
 
     int LuaBindings::funcGetEntity(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (pEntity)
         {
             lua_getglobal(L, "EINS_t");
@@ -347,7 +346,7 @@ namespace Engine
 
     int LuaBindings::funcGetPosition(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         auto v = pEntity ? pEntity->getPosition() : glm::vec2(0);
         LUA_PUSH_VEC2(v);
         return 1;
@@ -355,7 +354,7 @@ namespace Engine
 
     int LuaBindings::funcSetPosition(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (pEntity)
         {
             auto pos = LUA_GET_VEC2(2, glm::vec2(0));
@@ -366,7 +365,7 @@ namespace Engine
 
     int LuaBindings::funcGetWorldPosition(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         auto v = pEntity ? pEntity->getWorldPosition() : glm::vec2(0);
         LUA_PUSH_VEC2(v);
         return 1;
@@ -374,7 +373,7 @@ namespace Engine
 
     int LuaBindings::funcSetWorldPosition(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (pEntity)
         {
             auto pos = LUA_GET_VEC2(2, glm::vec2(0));
@@ -385,14 +384,14 @@ namespace Engine
 
     int LuaBindings::funcGetRotation(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         lua_pushnumber(L, (lua_Number)(pEntity ? pEntity->getRotation() : 0.0f));
         return 1;
     }
 
     int LuaBindings::funcSetRotation(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (pEntity)
         {
             auto angle = LUA_GET_NUMBER(2, 0.0f);
@@ -403,7 +402,7 @@ namespace Engine
 
     int LuaBindings::funcGetScale(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         auto v = pEntity ? pEntity->getScale() : glm::vec2(1);
         LUA_PUSH_VEC2(v);
         return 1;
@@ -411,7 +410,7 @@ namespace Engine
 
     int LuaBindings::funcSetScale(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (pEntity)
         {
             auto scale = LUA_GET_VEC2(2, glm::vec2(1));
@@ -483,7 +482,7 @@ namespace Engine
 
     int LuaBindings::funcPlaySound(lua_State* L)
     {
-        auto filename = LUA_GET_STRING(1, "");
+        auto filename = LUA_GET_RESOURCE_ID(1, "");
         auto vol = LUA_GET_NUMBER(2, 1.0f);
         auto bal = LUA_GET_NUMBER(3, 0.0f);
         auto pitch = LUA_GET_NUMBER(4, 1.0f);
@@ -515,7 +514,11 @@ namespace Engine
     int LuaBindings::funcSetSpriteTexture(lua_State* L)
     {
         auto pSprite = LUA_GET_COMPONENT(1, SpriteComponent);
-        if (pSprite) pSprite->pTexture = getResourceManager()->getTexture(LUA_GET_STRING(2, ""));
+        if (pSprite)
+        {
+            pSprite->pTexture = getResourceManager()->getTexture(LUA_GET_RESOURCE_ID(2, ""));
+            pSprite->markChanged();
+        }
         return 0;
     }
 
@@ -531,7 +534,11 @@ namespace Engine
     int LuaBindings::funcSetSpriteColor(lua_State* L)
     {
         auto pSprite = LUA_GET_COMPONENT(1, SpriteComponent);
-        if (pSprite) pSprite->color = LUA_GET_COLOR(2, glm::vec4(1, 1, 1, 1));
+        if (pSprite)
+        {
+            pSprite->color = LUA_GET_COLOR(2, glm::vec4(1, 1, 1, 1));
+            pSprite->markChanged();
+        }
         return 0;
     }
 
@@ -547,7 +554,11 @@ namespace Engine
     int LuaBindings::funcSetSpriteOrigin(lua_State* L)
     {
         auto pSprite = LUA_GET_COMPONENT(1, SpriteComponent);
-        if (pSprite) pSprite->origin = LUA_GET_VEC2(2, glm::vec2(0.5f));
+        if (pSprite)
+        {
+            pSprite->origin = LUA_GET_VEC2(2, glm::vec2(0.5f));
+            pSprite->markChanged();
+        }
         return 0;
     }
 
@@ -565,7 +576,11 @@ namespace Engine
     int LuaBindings::funcSetFont(lua_State* L)
     {
         auto pText = LUA_GET_COMPONENT(1, TextComponent);
-        if (pText) pText->pFont = getResourceManager()->getFont(LUA_GET_STRING(2, ""));
+        if (pText)
+        {
+            pText->pFont = getResourceManager()->getFont(LUA_GET_RESOURCE_ID(2, ""));
+            pText->markChanged();
+        }
         return 0;
     }
 
@@ -581,7 +596,11 @@ namespace Engine
     int LuaBindings::funcSetText(lua_State* L)
     {
         auto pText = LUA_GET_COMPONENT(1, TextComponent);
-        if (pText) pText->text = LUA_GET_STRING(2, "");
+        if (pText)
+        {
+            pText->text = LUA_GET_STRING(2, "");
+            pText->markChanged();
+        }
         return 0;
     }
 
@@ -597,7 +616,11 @@ namespace Engine
     int LuaBindings::funcSetTextColor(lua_State* L)
     {
         auto pText = LUA_GET_COMPONENT(1, TextComponent);
-        if (pText) pText->color = LUA_GET_COLOR(2, glm::vec4(1, 1, 1, 1));
+        if (pText)
+        {
+            pText->color = LUA_GET_COLOR(2, glm::vec4(1, 1, 1, 1));
+            pText->markChanged();
+        }
         return 0;
     }
 
@@ -613,7 +636,11 @@ namespace Engine
     int LuaBindings::funcSetTextOrigin(lua_State* L)
     {
         auto pText = LUA_GET_COMPONENT(1, TextComponent);
-        if (pText) pText->origin = LUA_GET_VEC2(2, glm::vec2(0.5f));
+        if (pText)
+        {
+            pText->origin = LUA_GET_VEC2(2, glm::vec2(0.5f));
+            pText->markChanged();
+        }
         return 0;
     }
 
@@ -629,7 +656,11 @@ namespace Engine
     int LuaBindings::funcSetTextScale(lua_State* L)
     {
         auto pText = LUA_GET_COMPONENT(1, TextComponent);
-        if (pText) pText->scale = LUA_GET_NUMBER(2, 1.0f);
+        if (pText)
+        {
+            pText->scale = LUA_GET_NUMBER(2, 1.0f);
+            pText->markChanged();
+        }
         return 0;
     }
     
@@ -647,7 +678,11 @@ namespace Engine
     int LuaBindings::funcSetPFX(lua_State* L)
     {
         auto pPFXComponent = LUA_GET_COMPONENT(1, PFXComponent);
-        if (pPFXComponent) pPFXComponent->pPFX = getResourceManager()->getPFX(LUA_GET_STRING(2, ""));
+        if (pPFXComponent)
+        {
+            pPFXComponent->pPFX = getResourceManager()->getPFX(LUA_GET_RESOURCE_ID(2, ""));
+            pPFXComponent->markChanged();
+        }
         return 0;
     }
 
@@ -667,7 +702,7 @@ namespace Engine
 
     int LuaBindings::funcGetName(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         std::string ret = "";
         if (pEntity) ret = pEntity->name.c_str();
         lua_pushstring(L, ret.c_str());
@@ -676,8 +711,8 @@ namespace Engine
 
     int LuaBindings::funcSetName(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
-        if (pEntity) pEntity->name = LUA_GET_STRING(2, "");
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
+        if (pEntity) pEntity->setName(LUA_GET_STRING(2, ""));
         return 0;
     }
 
@@ -821,6 +856,26 @@ namespace Engine
         return 1;
     }
 
+    // Scene::view with component names, any number of them
+    int LuaBindings::funcFindEntitiesWithComponents(lua_State* L)
+    {
+        std::vector<ComponentTypeId> typeIds;
+        for (int i = 1, count = lua_gettop(L); i <= count; ++i)
+            typeIds.push_back(ComponentFactory::findTypeId(LUA_GET_STRING(i, "")));
+
+        const auto& entities = getScene()->view(typeIds.data(), (int)typeIds.size());
+
+        lua_createtable(L, (int)entities.size(), 0);
+        for (int i = 0, len = (int)entities.size(); i < len; ++i)
+        {
+            auto pEntity = entities[i];
+            LUA_PUSH_ENTITY(pEntity);
+            lua_seti(L, -2, i + 1);
+        }
+
+        return 1;
+    }
+
     int LuaBindings::funcContinueGame(lua_State* L)
     {
         m_stateChangeRequest = StateChangeRequest::ContinueGame;
@@ -889,6 +944,20 @@ namespace Engine
         return 1;
     }
 
+    PrefabRef LuaBindings::getPrefab(const std::string& filename)
+    {
+        auto it = m_prefabCache.find(filename);
+        if (it != m_prefabCache.end()) return it->second;
+
+        Json::Value json;
+        if (!Utils::loadJson(json, "assets/" + filename)) return nullptr;
+
+        getResourceManager()->preload(AssetManifest::loadOrScan("assets/" + filename, json));
+        auto pPrefab = Prefab::compile(json["root"]);
+        m_prefabCache[filename] = pPrefab;
+        return pPrefab;
+    }
+
     int LuaBindings::funcCreateEntity(lua_State* L)
     {
         auto pParent = LUA_GET_ENTITY(1);
@@ -901,32 +970,60 @@ namespace Engine
             return 1;
         }
 
-        auto pEntity = getScene()->createEntity(pParent);
-
+        EntityRef pEntity;
         if (!prefab.empty())
         {
-            auto it = m_prefabCache.find(prefab);
-            if (it == m_prefabCache.end())
-            {
-                Json::Value json;
-                if (Utils::loadJson(json, "assets/" + prefab))
-                {
-                    m_prefabCache[prefab] = json;
-                    it = m_prefabCache.find(prefab);
-                }
-            }
-
-            if (it != m_prefabCache.end())
-            {
-                const auto& json = it->second;
-                pEntity->deserialize(json["root"]);
-            }
+            if (auto pPrefab = getPrefab(prefab))
+                pEntity = pPrefab->instantiate(pParent);
         }
+        if (!pEntity) pEntity = getScene()->createEntity(pParent);
 
         LUA_PUSH_ENTITY(pEntity);
         return 1;
     }
 
+    int LuaBindings::funcCreateEntities(lua_State* L)
+    {
+        auto pParent = LUA_GET_ENTITY(1);
+        auto prefab = LUA_GET_STRING(2, "");
+        auto count = LUA_GET_INT(3, 1);
+
+        if (!pParent)
+        {
+            CORE_ERROR_POPUP("Lua: Expected first argument to be entity in CreateEntities(parent, prefabName, count)");
+            lua_pushnil(L);
+            return 1;
+        }
+
+        auto pPrefab = getPrefab(prefab);
+        if (!pPrefab)
+        {
+            CORE_ERROR_POPUP("Lua: CreateEntities, invalid prefab: {}", prefab);
+            lua_pushnil(L);
+            return 1;
+        }
+
+        if (count < 1)
+        {
+            CORE_ERROR_POPUP("Lua: CreateEntities, count must be at least 1: {}", count);
+            lua_pushnil(L);
+            return 1;
+        }
+
+        std::vector<EntityRef> entities;
+        pPrefab->instantiate(pParent, count, entities);
+
+        lua_createtable(L, (int)entities.size(), 0);
+        for (int i = 0, len = (int)entities.size(); i < len; ++i)
+        {
+            const auto& pEntity = entities[i];
+            LUA_PUSH_ENTITY(pEntity);
+            lua_seti(L, -2, i + 1);
+        }
+
+        return 1;
+    }
+
     int LuaBindings::funcAddComponent(lua_State* L)
     {
         auto pEntity = LUA_GET_ENTITY(1);
@@ -965,6 +1062,7 @@ namespace Engine
         }
 
         auto pScriptComponent = pEntity->addComponent<Engine::ScriptComponent>();
+        pScriptComponent->name = componentName;
         pScriptComponent->loadDef(pDef);
         
         lua_getglobal(L, "CINS_t");
@@ -974,27 +1072,12 @@ namespace Engine
 
     int LuaBindings::funcRemoveComponent(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (!pEntity) return 0;
 
         auto componentName = LUA_GET_STRING(2, "");
-        for (const auto& pComponent : pEntity->getComponents())
-        {
-            if (pComponent->getType() == "Script")
-            {
-                auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-                if (pScriptComponent->name == componentName)
-                {
-                    pEntity->removeComponent(pComponent);
-                    return 0;
-                }
-            }
-            if (pComponent->getType() == componentName)
-            {
-                pEntity->removeComponent(pComponent);
-                return 0;
-            }
-        }
+        auto pComponent = pEntity->getComponentByName(componentName);
+        if (pComponent) pEntity->removeComponent(pComponent);
 
         return 0;
     }
@@ -1170,7 +1253,7 @@ namespace Engine
 
     int LuaBindings::funcEmitParticles(lua_State* L)
     {
-        std::string pfxName = LUA_GET_STRING(1, "particles/defaultPFX.json");
+        auto pfxName = LUA_GET_RESOURCE_ID(1, "particles/defaultPFX.json");
         glm::vec2 position = LUA_GET_VEC2(2, glm::vec2(0, 0));
         float rotation = LUA_GET_NUMBER(3, 0.0f);
         glm::vec2 scale = glm::vec2(LUA_GET_NUMBER(4, 1.0f));
@@ -1209,56 +1292,45 @@ namespace Engine
 
     int LuaBindings::funcEnableComponent(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (!pEntity) return 0;
 
         auto componentName = LUA_GET_STRING(2, "");
 
-        for (const auto& pComponent : pEntity->getComponents())
-        {
-            if (componentName == pComponent->getType())
-            {
-                pComponent->enable();
-                break;
-            }
-            auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-            if (pScriptComponent)
-            {
-                if (pScriptComponent->name == componentName)
-                {
-                    pComponent->enable();
-                    return 0;
-                }
-            }
-        }
+        auto pComponent = pEntity->getComponentByName(componentName);
+        if (pComponent) pComponent->enable();
 
         return 0;
     }
 
     int LuaBindings::funcDisableComponent(lua_State* L)
     {
-        auto pEntity = LUA_GET_ENTITY(1);
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
         if (!pEntity) return 0;
 
         auto componentName = LUA_GET_STRING(2, "");
 
-        for (const auto& pComponent : pEntity->getComponents())
-        {
-            if (componentName == pComponent->getType())
-            {
-                pComponent->disable();
-                break;
-            }
-            auto pScriptComponent = std::dynamic_pointer_cast<ScriptComponent>(pComponent);
-            if (pScriptComponent)
-            {
-                if (pScriptComponent->name == componentName)
-                {
-                    pComponent->disable();
-                    return 0;
-                }
-            }
-        }
+        auto pComponent = pEntity->getComponentByName(componentName);
+        if (pComponent) pComponent->disable();
+
+        return 0;
+    }
+
+    int LuaBindings::funcSetTickPolicy(lua_State* L)
+    {
+        auto pEntity = LUA_GET_ENTITY_RAW(1);
+        if (!pEntity) return 0;
+
+        auto componentName = LUA_GET_STRING(2, "");
+
+        auto pComponent = pEntity->getComponentByName(componentName);
+        if (!pComponent) return 0;
+
+        TickPolicy tickPolicy;
+        tickPolicy.interval = LUA_GET_INT(3, 1);
+        tickPolicy.offscreenInterval = LUA_GET_INT(4, tickPolicy.interval);
+        tickPolicy.dormantDistance = LUA_GET_NUMBER(5, 0.0f);
+        pComponent->setTickPolicy(tickPolicy);
 
         return 0;
     }
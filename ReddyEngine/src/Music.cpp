@@ -63,7 +63,13 @@ namespace Engine
         m_buffers.clear();
         m_bufferCount = 0;
 
-        m_pStream = stb_vorbis_open_filename((char*)m_filename.c_str(), NULL, NULL);
+        if (!m_fileData.pData && !FileSystem::readFile(m_filename, m_fileData))
+        {
+            CORE_ERROR("Failed to open file: {}", m_filename);
+            return;
+        }
+
+        m_pStream = stb_vorbis_open_memory(m_fileData.pData, (int)m_fileData.size, NULL, NULL);
         if (!m_pStream)
         {
             CORE_ERROR("Failed to open file: {}", m_filename);
@@ -7,6 +7,8 @@
 
 #include <glm/glm.hpp>
 
+#include <atomic>
+
 
 namespace Engine
 {
@@ -126,7 +128,10 @@ namespace Engine
         }
     }
     
+    static std::atomic<uint32_t> s_nextRandomSeed(1);
+
     PFXInstance::PFXInstance(const PFXRef& pPFX)
+        : m_random(s_nextRandomSeed.fetch_add(0x9E3779B9)) // Spread out, so instances don't start on similar sequences
     {
         m_pPFX = pPFX;
 
@@ -220,17 +225,17 @@ namespace Engine
             {
                 pParticle->position = {0, 0};
 
-                auto radius = emitter.pEmitterRef->spawnRadius.gen();
-                float t = ((float)(rand() % 10001) / 10000.0f);
+                auto radius = emitter.pEmitterRef->spawnRadius.gen(m_random);
+                float t = m_random.next();
                 float dist = Utils::lerp(emitter.pEmitterRef->spawnRadius.range[0], emitter.pEmitterRef->spawnRadius.range[1], t);
-                float angle = ((float)(rand() % 10001) / 10000.0f) * 6.283185307179586476925286766559f;
+                float angle = m_random.next() * 6.283185307179586476925286766559f;
 
                 pParticle->position.x += std::cosf(angle) * dist;
                 pParticle->position.y += std::sinf(angle) * dist;
             }
-            pParticle->delay = 1.0f / emitter.pEmitterRef->duration.gen();
-            pParticle->colorStart = emitter.pEmitterRef->color.genStart();
-            pParticle->colorEnd = emitter.pEmitterRef->color.genEnd(pParticle->colorStart);
+            pParticle->delay = 1.0f / emitter.pEmitterRef->duration.gen(m_random);
+            pParticle->colorStart = emitter.pEmitterRef->color.genStart(m_random);
+            pParticle->colorEnd = emitter.pEmitterRef->color.genEnd(pParticle->colorStart, m_random);
 
             if (emitter.pEmitterRef->endOnlyAffectAlpha)
             {
@@ -239,21 +244,21 @@ namespace Engine
                 pParticle->colorEnd.b = pParticle->colorStart.b;
             }
 
-            pParticle->additiveStart = emitter.pEmitterRef->additive.genStart();
-            pParticle->additiveEnd = emitter.pEmitterRef->additive.genEnd(pParticle->additiveStart);
-            pParticle->gravityStart = emitter.pEmitterRef->gravity.genStart();
-            pParticle->gravityEnd = emitter.pEmitterRef->gravity.genEnd(pParticle->gravityStart);
-            pParticle->sizeStart = emitter.pEmitterRef->size.genStart();
-            pParticle->sizeEnd = emitter.pEmitterRef->size.genEnd(pParticle->sizeStart);
-            pParticle->rotationSpeedStart = emitter.pEmitterRef->rotationSpeed.genStart();
-            pParticle->rotationSpeedEnd = emitter.pEmitterRef->rotationSpeed.genEnd(pParticle->rotationSpeedStart);
-            pParticle->rotation = emitter.pEmitterRef->rotation.gen();
-            pParticle->speedStart = emitter.pEmitterRef->speed.genStart();
-            pParticle->speedEnd = emitter.pEmitterRef->speed.genEnd(pParticle->speedStart);
+            pParticle->additiveStart = emitter.pEmitterRef->additive.genStart(m_random);
+            pParticle->additiveEnd = emitter.pEmitterRef->additive.genEnd(pParticle->additiveStart, m_random);
+            pParticle->gravityStart = emitter.pEmitterRef->gravity.genStart(m_random);
+            pParticle->gravityEnd = emitter.pEmitterRef->gravity.genEnd(pParticle->gravityStart, m_random);
+            pParticle->sizeStart = emitter.pEmitterRef->size.genStart(m_random);
+            pParticle->sizeEnd = emitter.pEmitterRef->size.genEnd(pParticle->sizeStart, m_random);
+            pParticle->rotationSpeedStart = emitter.pEmitterRef->rotationSpeed.genStart(m_random);
+            pParticle->rotationSpeedEnd = emitter.pEmitterRef->rotationSpeed.genEnd(pParticle->rotationSpeedStart, m_random);
+            pParticle->rotation = emitter.pEmitterRef->rotation.gen(m_random);
+            pParticle->speedStart = emitter.pEmitterRef->speed.genStart(m_random);
+            pParticle->speedEnd = emitter.pEmitterRef->speed.genEnd(pParticle->speedStart, m_random);
             pParticle->pTexture = emitter.pEmitterRef->pTexture;
             pParticle->texInvSize = emitter.pEmitterRef->pTexture ? 1.0f / (float)emitter.pEmitterRef->pTexture->getSize().x : 1.0f;
             {
-                float angle = emitter.pEmitterRef->spread * ((float)(rand() % 10001) / 10000.0f);
+                float angle = emitter.pEmitterRef->spread * m_random.next();
                 angle -= emitter.pEmitterRef->spread * 0.5f;
                 auto radTheta = glm::radians(angle);
                 auto sinTheta = std::sin(radTheta);
@@ -0,0 +1,115 @@
+#include "Engine/Prefab.h"
+#include "Engine/Component.h"
+#include "Engine/ReddyEngine.h"
+#include "Engine/Scene.h"
+#include "Engine/Utils.h"
+
+
+namespace Engine
+{
+    PrefabRef Prefab::compile(const Json::Value& json)
+    {
+        auto pPrefab = std::make_shared<Prefab>();
+        pPrefab->compileEntity(json, -1);
+        return pPrefab;
+    }
+
+    // Same reads as Entity::deserialize, done once
+    void Prefab::compileEntity(const Json::Value& json, int parent)
+    {
+        EntityRecord record;
+        Entity::readRecord(json, record.entity);
+        record.entity.parent = parent;
+
+        record.componentBegin = (int)m_components.size();
+        for (const auto& componentJson : json["components"])
+        {
+            auto create = ComponentFactory::getFactory(Utils::deserializeString(componentJson["type"]));
+            if (!create) continue;
+
+            ComponentRecord componentRecord;
+            auto pComponent = create();
+            if (ComponentFactory::canClone(pComponent))
+            {
+                pComponent->deserialize(componentJson);
+                componentRecord.pPrototype = pComponent;
+            }
+            else
+            {
+                componentRecord.create = create;
+                componentRecord.json = componentJson;
+            }
+            m_components.push_back(std::move(componentRecord));
+        }
+        record.componentEnd = (int)m_components.size();
+
+        auto index = (int)m_entities.size();
+        m_entities.push_back(std::move(record));
+
+        for (const auto& childJson : json["children"])
+            compileEntity(childJson, index);
+    }
+
+    EntityRef Prefab::instantiateEntity(const EntityRecord& record, const EntityRef& pParent) const
+    {
+        auto pEntity = getScene()->createEntity(pParent);
+
+        pEntity->applyRecord(record.entity);
+
+        for (int i = record.componentBegin; i < record.componentEnd; ++i)
+        {
+            const auto& componentRecord = m_components[i];
+
+            ComponentRef pComponent;
+            if (componentRecord.pPrototype)
+            {
+                pComponent = ComponentFactory::clone(componentRecord.pPrototype);
+            }
+            else
+            {
+                pComponent = componentRecord.create();
+                pComponent->deserialize(componentRecord.json);
+            }
+            pEntity->addComponent(pComponent);
+        }
+
+        return pEntity;
+    }
+
+    EntityRef Prefab::instantiate(const EntityRef& pParent) const
+    {
+        if (m_entities.size() == 1)
+            return pParent && getScene() ? instantiateEntity(m_entities[0], pParent) : nullptr;
+
+        std::vector<EntityRef> entities;
+        instantiate(pParent, 1, entities);
+        return entities.empty() ? nullptr : entities[0];
+    }
+
+    void Prefab::instantiate(const EntityRef& pParent, int count, std::vector<EntityRef>& outEntities) const
+    {
+        if (m_entities.empty() || !pParent || !getScene() || count <= 0) return;
+
+        outEntities.reserve(outEntities.size() + count);
+
+        // Single entity prefabs (bullets and such) don't need to remember parents
+        if (m_entities.size() == 1)
+        {
+            for (int i = 0; i < count; ++i)
+                outEntities.push_back(instantiateEntity(m_entities[0], pParent));
+            return;
+        }
+
+        // Records are parent before child, so a child's parent is always created already
+        std::vector<EntityRef> instance(m_entities.size());
+        for (int i = 0; i < count; ++i)
+        {
+            for (int e = 0; e < (int)m_entities.size(); ++e)
+            {
+                const auto& record = m_entities[e];
+                instance[e] = instantiateEntity(record, record.entity.parent == -1 ? pParent : instance[record.entity.parent]);
+            }
+            outEntities.push_back(instance[0]);
+        }
+    }
+}
@@ -1,11 +1,14 @@
 #include "Engine/Audio.h"
 #include "Engine/ReddyEngine.h"
 #include "Engine/Config.h"
+#include "Engine/FileSystem.h"
 #include "Engine/Input.h"
+#include "Engine/JobSystem.h"
 #include "Engine/Log.h"
 #include "Engine/SpriteBatch.h"
 #include "Engine/ResourceManager.h"
 #include "Engine/Scene.h"
+#include "Engine/SceneBinary.h"
 #include "Engine/EventSystem.h"
 #include "Engine/LuaBindings.h"
 #include "Engine/MusicManager.h"
@@ -13,6 +16,8 @@
 #include "Engine/Entity.h"
 #include "Engine/Scene.h"
 #include "Engine/Font.h"
+#include "Engine/Texture.h"
+#include "Engine/Utils.h"
 
 #include <backends/imgui_impl_sdl.h>
 #include <backends/imgui_impl_opengl3.h>
@@ -20,6 +25,7 @@
 #include <SDL_opengl.h>
 
 #include <cassert>
+#include <cstring>
 
 
 namespace Engine
@@ -33,6 +39,7 @@ namespace Engine
 	static LuaBindingsRef g_pLuaBindings;
 	static IGameRef g_pGame;
 	static MusicManagerRef g_pMusicManager;
+	static JobSystemRef g_pJobSystem;
 	static FontRef g_pFPSFont;
 
     static int g_fixedUpdateFPS = 60;
@@ -46,6 +53,38 @@ namespace Engine
 
         // Don't use CORE_ERROR etc. before spdlog initialization 
         Log::Init();
+
+        // "--pack [output.rpak]" bundles the assets folder and quits
+        for (int i = 1; i < argc; ++i)
+        {
+            if (strcmp(argv[i], "--pack") == 0)
+            {
+                std::string packFilename = (i + 1 < argc) ? argv[i + 1] : "assets.rpak";
+                FileSystem::buildPack("assets", packFilename, true, [](const std::string& filename, const FileSystem::FileData& data, std::vector<FileSystem::CookedFile>& outCookedFiles)
+                {
+                    // Low res version of big textures, shown while they stream in
+                    FileSystem::CookedFile thumbnail;
+                    if (Texture::cookThumbnail(data.pData, data.size, thumbnail.data))
+                    {
+                        thumbnail.filename = filename + ".thumb";
+                        outCookedFiles.push_back(thumbnail);
+                    }
+
+                    // Binary version of scenes, loads without parsing any json
+                    FileSystem::CookedFile scene;
+                    if (Utils::getExtension(filename) == "JSON" && SceneBinary::cook(data.pData, data.size, scene.data))
+                    {
+                        scene.filename = SceneBinary::getBinaryFilename(filename);
+                        outCookedFiles.push_back(scene);
+                    }
+                });
+                return;
+            }
+        }
+
+        // Asset pack has priority over loose files, but is optional
+        if (Utils::fileExists("assets.rpak"))
+            FileSystem::mountPack("assets.rpak");
         
         // Load configs
         Config::load();
@@ -133,6 +172,7 @@ namespace Engine
 
         // Initialize Engine's systems
         ComponentFactory::initialize();
+        g_pJobSystem = std::make_shared<JobSystem>();
         g_pEventSystem = std::make_shared<EventSystem>();
         g_pInput = std::make_shared<Input>();
         g_pAudio = std::make_shared<Audio>();
@@ -299,6 +339,7 @@ namespace Engine
             glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
             glClearColor(0, 0, 0, 1);
             glClear(GL_COLOR_BUFFER_BIT);
+            Texture::updateStreaming();
             g_pSpriteBatch->beginFrame();
 
             // Draw game
@@ -341,6 +382,8 @@ namespace Engine
         g_pAudio.reset();
         g_pInput.reset();
         g_pEventSystem.reset();
+        g_pJobSystem.reset();
+        FileSystem::unmountPacks();
 
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplSDL2_Shutdown();
@@ -403,6 +446,11 @@ namespace Engine
         return g_pMusicManager;
     }
 
+    const JobSystemRef& getJobSystem()
+    {
+        return g_pJobSystem;
+    }
+
 	glm::vec2 getResolution()
     {
         const auto& io = ImGui::GetIO();
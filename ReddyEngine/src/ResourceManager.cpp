@@ -6,45 +6,104 @@
 #include "Engine/Font.h"
 
 #include "Engine/ResourceManager.h"
+#include "Engine/JobSystem.h"
+#include "Engine/ReddyEngine.h"
 
 #include "Engine/Log.h"
 #include "Engine/Resource.h"
 
 
 #include <string>
+#include <mutex>
 #include <unordered_map>
 #include <filesystem>
 
 namespace Engine
 {
-    SoundRef ResourceManager::getSound(const std::string& name)
+    static std::mutex s_internMutex;
+    static std::unordered_map<uint64_t, std::string> s_internedNames;
+
+    ResourceId::ResourceId(const std::string& name)
+        : m_hash(hashPathChars(name.c_str(), name.size(), ASSETS_PATH_SEED))
+    {
+        // Node based map, the string never moves once it's in
+        std::lock_guard<std::mutex> lock(s_internMutex);
+        auto it = s_internedNames.find(m_hash);
+        if (it == s_internedNames.end()) it = s_internedNames.emplace(m_hash, name).first;
+        m_pName = it->second.c_str();
+    }
+
+    SoundRef ResourceManager::getSound(const ResourceId& id)
+    {
+        return getResource(m_sounds, id);
+    }
+
+    MusicRef ResourceManager::getMusic(const ResourceId& id)
     {
-        return getResource<Sound>(name);
+        return getResource(m_musics, id);
     }
 
-    MusicRef ResourceManager::getMusic(const std::string& name)
+    TextureRef ResourceManager::getTexture(const ResourceId& id)
     {
-        return getResource<Music>(name);
+        return getResource(m_textures, id);
     }
 
-    TextureRef ResourceManager::getTexture(const std::string& name)
+    PFXRef ResourceManager::getPFX(const ResourceId& id)
     {
-        return getResource<Texture>(name);
+        return getResource(m_pfxs, id);
     }
 
-    PFXRef ResourceManager::getPFX(const std::string& name)
+    FontRef ResourceManager::getFont(const ResourceId& id)
     {
-        return getResource<PFX>(name);
+        return getResource(m_fonts, id);
     }
 
-    FontRef ResourceManager::getFont(const std::string& name)
+    FrameAnimRef ResourceManager::getFrameAnim(const ResourceId& id)
     {
-        return getResource<Font>(name);
+        return getResource(m_frameAnims, id);
     }
 
-    FrameAnimRef ResourceManager::getFrameAnim(const std::string& name)
+    void ResourceManager::preload(const AssetManifest& manifest)
     {
-        return getResource<FrameAnim>(name);
+        struct DecodedTexture
+        {
+            std::string filename;
+            glm::ivec2 size;
+            std::vector<uint8_t> pixels;
+            bool decoded = false;
+        };
+
+        std::vector<DecodedTexture> decodedTextures;
+        for (const auto& filename : manifest.textures)
+        {
+            if (m_textures.find(ResourceId(filename)) != m_textures.end()) continue;
+            decodedTextures.push_back({ filename, glm::ivec2(0), {}, false });
+        }
+
+        // File reads and image decoding in parallel. GL upload has to stay here on the main thread.
+        getJobSystem()->parallelFor((int)decodedTextures.size(), [&decodedTextures](int i)
+        {
+            auto& decodedTexture = decodedTextures[i];
+            decodedTexture.decoded = Texture::decodeFile("assets/" + decodedTexture.filename, decodedTexture.size, decodedTexture.pixels, true);
+        });
+
+        for (const auto& decodedTexture : decodedTextures)
+        {
+            if (!decodedTexture.decoded) continue;
+            if (decodedTexture.pixels.empty()) // Big enough to stream, it decodes on its own
+            {
+                getTexture(decodedTexture.filename);
+                continue;
+            }
+            auto pTexture = Texture::createFromData(decodedTexture.size, decodedTexture.pixels.data());
+            pTexture->setFilename(decodedTexture.filename);
+            m_textures[ResourceId(decodedTexture.filename)] = pTexture;
+        }
+
+        // These are small json files, their textures are already in
+        for (const auto& filename : manifest.fonts) getFont(filename);
+        for (const auto& filename : manifest.pfxs) getPFX(filename);
+        for (const auto& filename : manifest.frameAnims) getFrameAnim(filename);
     }
 
     bool ResourceManager::copyFileToAssets(const std::string &path, const std::string& subDir, std::string& resultPath)
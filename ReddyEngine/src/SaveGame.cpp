@@ -0,0 +1,200 @@
+#include "Engine/SaveGame.h"
+#include "Engine/FileSystem.h"
+#include "Engine/Log.h"
+#include "Engine/ReddyEngine.h"
+#include "Engine/Scene.h"
+#include "Engine/SceneBinary.h"
+#include "Engine/Utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+
+namespace Engine
+{
+    SaveGame::SaveGame(const std::string& filename)
+        : m_baseFilename(SceneBinary::getBinaryFilename(filename))
+        , m_logFilename(Utils::getPathWithoutExtension(filename) + ".rdelta")
+    {
+    }
+
+    SaveGame::~SaveGame()
+    {
+        flush();
+    }
+
+    void SaveGame::begin(const Json::Value& sceneExtras)
+    {
+        m_sceneExtras = sceneExtras; // Written back with every base, the asset manifest especially
+        m_sceneExtras.removeMember("save");
+
+        const auto& saveJson = sceneExtras["save"];
+        if (saveJson.isNull())
+        {
+            // New game. A fresh generation, so a log left behind by an older save never matches
+            m_generation = (uint64_t)std::chrono::system_clock::now().time_since_epoch().count();
+            compact();
+            return;
+        }
+
+        m_generation = Utils::deserializeUInt64(saveJson["generation"]);
+        if (!replayLog())
+        {
+            compact(); // Don't append after a damaged entry, start over from what we could read
+            return;
+        }
+        getScene()->trackChanges();
+    }
+
+    // One json object per line. A cut off last line means the game stopped while writing it.
+    bool SaveGame::replayLog()
+    {
+        FileSystem::FileData data;
+        if (!FileSystem::fileExists(m_logFilename) || !FileSystem::readFile(m_logFilename, data)) return true;
+
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> pReader(builder.newCharReader());
+
+        auto pBegin = (const char*)data.pData;
+        auto pEnd = pBegin + data.size;
+        while (pBegin < pEnd)
+        {
+            auto pLineEnd = std::find(pBegin, pEnd, '\n');
+            Json::Value changes;
+            if (pLineEnd == pEnd || !pReader->parse(pBegin, pLineEnd, &changes, nullptr))
+            {
+                CORE_ERROR("Save game log is damaged, ignoring the rest: {}", m_logFilename);
+                return false;
+            }
+
+            if (Utils::deserializeUInt64(changes["generation"]) == m_generation)
+            {
+                getScene()->applyChanges(changes);
+                ++m_logEntryCount;
+            }
+            pBegin = pLineEnd + 1;
+        }
+        return true;
+    }
+
+    void SaveGame::save()
+    {
+        auto changes = getScene()->takeChanges();
+        if (changes.isNull() && !m_isRewriteNeeded) return;
+
+        if (m_isRewriteNeeded || ++m_logEntryCount >= COMPACT_EVERY)
+        {
+            compact();
+            return;
+        }
+
+        changes["generation"] = Utils::serializeUInt64(m_generation);
+        auto pWrite = std::make_shared<Write>();
+        pWrite->changes = std::move(changes);
+        queue(pWrite);
+    }
+
+    void SaveGame::compact()
+    {
+        ++m_generation;
+        m_logEntryCount = 0;
+        m_isRewriteNeeded = false;
+
+        auto extras = m_sceneExtras;
+        extras["save"]["generation"] = Utils::serializeUInt64(m_generation);
+
+        auto pWrite = std::make_shared<Write>();
+        getScene()->serializeBinary(pWrite->base, extras);
+        getScene()->trackChanges();
+        queue(pWrite);
+    }
+
+    void SaveGame::queue(const WriteRef& pWrite)
+    {
+        m_writes.push_back(pWrite);
+        update();
+    }
+
+    // One write at a time, log entries have to land in order
+    void SaveGame::update()
+    {
+        if (m_isWriting)
+        {
+            if (!m_counter.isDone()) return;
+
+            m_isWriting = false;
+            if (m_writes.front()->failed) writeFailed();
+            m_writes.pop_front();
+        }
+        if (m_writes.empty()) return;
+
+        auto pWrite = m_writes.front();
+        const auto& pJobSystem = getJobSystem();
+        if (!pJobSystem) // Shutting down
+        {
+            if (!writeFiles(*pWrite, m_baseFilename, m_logFilename)) writeFailed();
+            m_writes.pop_front();
+            update();
+            return;
+        }
+
+        m_isWriting = true;
+        auto baseFilename = m_baseFilename;
+        auto logFilename = m_logFilename;
+        pJobSystem->schedule([pWrite, baseFilename, logFilename]()
+        {
+            pWrite->failed = !writeFiles(*pWrite, baseFilename, logFilename);
+        }, &m_counter);
+    }
+
+    // A base that didn't make it leaves log entries of its generation with nothing to apply to, and a
+    // lost log entry leaves a hole. Either way the next save writes everything again.
+    void SaveGame::writeFailed()
+    {
+        CORE_ERROR("Failed to write save game: {}", m_baseFilename);
+        m_isRewriteNeeded = true;
+    }
+
+    void SaveGame::flush()
+    {
+        while (!m_writes.empty())
+        {
+            if (m_isWriting && getJobSystem()) getJobSystem()->wait(m_counter);
+            update();
+        }
+    }
+
+    // On a worker, no logging. A new base goes through a temporary file, so a crash leaves the
+    // previous one. Log entries left from it are then skipped by their generation.
+    bool SaveGame::writeFiles(const Write& write, const std::string& baseFilename, const std::string& logFilename)
+    {
+        if (!write.base.empty())
+        {
+            auto tempFilename = baseFilename + ".tmp";
+            {
+                std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+                if (!file.is_open()) return false;
+                file.write((const char*)write.base.data(), write.base.size());
+                if (!file) return false;
+            }
+
+            std::error_code error;
+            std::filesystem::rename(tempFilename, baseFilename, error);
+            if (error) return false;
+
+            std::ofstream log(logFilename, std::ios::binary | std::ios::trunc);
+            return log.is_open();
+        }
+
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        auto line = Json::writeString(builder, write.changes);
+
+        std::ofstream log(logFilename, std::ios::binary | std::ios::app);
+        if (!log.is_open()) return false;
+        log << line << '\n';
+        return (bool)log;
+    }
+}
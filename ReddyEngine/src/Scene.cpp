@@ -1,11 +1,19 @@
 #include "Engine/Scene.h"
+#include "Engine/Component.h"
 #include "Engine/Entity.h"
 #include "Engine/Log.h"
 #include "Engine/EventSystem.h"
+#include "Engine/JobSystem.h"
 #include "Engine/ReddyEngine.h"
+#include "Engine/SceneBinary.h"
+#include "Engine/SpatialGrid.h"
+#include "Engine/TransformSystem.h"
+#include "Engine/Utils.h"
 #include "ComponentManager.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 
 namespace Engine
 {
@@ -15,11 +23,13 @@ namespace Engine
 
 	void Scene::init()
 	{
+		m_pSpatialGrid = std::make_shared<SpatialGrid>(this); // Before any entity, they register in it
+		m_pTransformSystem = std::make_shared<TransformSystem>(this);
 		m_pRoot = (std::make_shared<Entity>());
 		m_id = 0;
 		m_pComponentManager = std::make_shared<ComponentManager>();
 
-		m_pRoot->name = "Root";
+		m_pRoot->setName("Root");
 		m_pRoot->clickThrough = true; // We cannot select the root
 
 		REGISTER_EVENT(MouseButtonDownEvent, Scene::onMouseDown);
@@ -45,40 +55,358 @@ namespace Engine
 		clear();
 		m_pRoot->deserialize(json["root"]);
 		m_pRoot->clickThrough = true; // We cannot select the root
+
+#if defined(DEBUG)
+		CORE_ASSERT(checkEntityIndex(), "Entity id index doesn't match the scene");
+#endif
+	}
+
+	// Component serialization is the expensive part, it's done in parallel up front.
+	// The writer itself interns strings, so it stays on this thread.
+	void Scene::serializeBinary(std::vector<uint8_t>& out, const Json::Value& extras)
+	{
+		// Parent before child, with the index of each entity's parent
+		std::vector<std::pair<Entity*, int>> entities;
+		std::vector<Component*> components;
+		std::vector<std::pair<Entity*, int>> stack = { { m_pRoot.get(), -1 } };
+		while (!stack.empty())
+		{
+			auto item = stack.back();
+			stack.pop_back();
+
+			auto index = (int)entities.size();
+			entities.push_back(item);
+			for (const auto& pComponent : item.first->getComponents())
+				components.push_back(pComponent.get());
+
+			const auto& children = item.first->getChildren();
+			for (auto rit = children.rbegin(); rit != children.rend(); ++rit)
+				stack.push_back({ rit->get(), index });
+		}
+
+		std::vector<Json::Value> componentJsons(components.size());
+		serializeComponents(components, componentJsons);
+
+		SceneBinaryWriter writer;
+		writer.setExtras(extras);
+
+		SceneEntityRecord record;
+		size_t componentIndex = 0;
+		for (const auto& item : entities)
+		{
+			auto pEntity = item.first;
+			record.parent = item.second;
+			pEntity->getRecord(record);
+
+			writer.writeEntity(record);
+			for (int i = 0; i < record.componentCount; ++i)
+				writer.writeComponent(componentJsons[componentIndex++]);
+		}
+
+		writer.finish(out);
+	}
+
+	void Scene::serializeComponents(const std::vector<Component*>& components, std::vector<Json::Value>& outJsons)
+	{
+		const auto& pJobSystem = getJobSystem();
+		if (pJobSystem && (int)components.size() >= PARALLEL_MIN_COMPONENTS)
+		{
+			pJobSystem->parallelFor((int)components.size(), [&](int i)
+			{
+				outJsons[i] = components[i]->serialize();
+			}, Entity::PARALLEL_SERIALIZE_BATCH_SIZE);
+			return;
+		}
+
+		for (size_t i = 0; i < components.size(); ++i)
+			outJsons[i] = components[i]->serialize();
+	}
+
+	// Three passes: the records are read and the component blobs located, the blobs are decoded
+	// to json in parallel, then everything is created here in one go. The scene is only cleared
+	// once the whole file checked out.
+	bool Scene::deserializeBinary(const uint8_t* pData, size_t size)
+	{
+		SceneBinaryReader reader;
+		if (!reader.open(pData, size)) return false;
+
+		std::vector<SceneEntityRecord> records;
+		std::vector<size_t> componentOffsets;
+		records.reserve(reader.getEntityCount());
+
+		SceneEntityRecord record;
+		while (reader.readEntity(record))
+		{
+			for (int i = 0; i < record.componentCount; ++i)
+			{
+				size_t offset;
+				if (!reader.skipComponent(offset)) break;
+				componentOffsets.push_back(offset);
+			}
+			records.push_back(std::move(record));
+		}
+		if (reader.hasError()) return false;
+
+		std::vector<Json::Value> componentJsons(componentOffsets.size());
+		std::atomic<bool> decodeFailed(false);
+		auto decode = [&](int i)
+		{
+			if (!reader.decodeComponent(componentOffsets[i], componentJsons[i]))
+				decodeFailed = true;
+		};
+		const auto& pJobSystem = getJobSystem();
+		if (pJobSystem && (int)componentOffsets.size() >= PARALLEL_MIN_COMPONENTS)
+		{
+			pJobSystem->parallelFor((int)componentOffsets.size(), decode, Entity::PARALLEL_SERIALIZE_BATCH_SIZE);
+		}
+		else
+		{
+			for (int i = 0; i < (int)componentOffsets.size(); ++i)
+				decode(i);
+		}
+		if (decodeFailed)
+		{
+			CORE_ERROR("Corrupted binary scene");
+			return false;
+		}
+
+		clear();
+
+		std::vector<Entity*> entities;
+		entities.reserve(records.size());
+
+		size_t componentIndex = 0;
+		for (const auto& entityRecord : records)
+		{
+			// Like Entity::deserialize, components before children
+			auto pEntity = m_pRoot;
+			if (entityRecord.parent != -1)
+			{
+				pEntity = allocateEntity();
+				entities[entityRecord.parent]->addChild(pEntity);
+			}
+
+			auto previousId = pEntity->id;
+			pEntity->id = entityRecord.id;
+			updateMaxId(pEntity->id);
+			indexEntity(pEntity.get(), previousId);
+			pEntity->applyRecord(entityRecord);
+
+			for (int i = 0; i < entityRecord.componentCount; ++i)
+			{
+				const auto& componentJson = componentJsons[componentIndex++];
+
+				auto pComponent = ComponentFactory::create(Utils::deserializeString(componentJson["type"]));
+				if (!pComponent) continue;
+
+				pComponent->deserialize(componentJson);
+				pEntity->addComponent(pComponent);
+			}
+
+			entities.push_back(pEntity.get());
+		}
+		m_pRoot->clickThrough = true; // We cannot select the root
+
+#if defined(DEBUG)
+		CORE_ASSERT(checkEntityIndex(), "Entity id index doesn't match the scene");
+#endif
+		return true;
+	}
+
+	void Scene::trackChanges()
+	{
+		m_isTrackingChanges = true;
+		m_changedEntities.clear();
+		m_destroyedIds.clear();
+
+		std::vector<Entity*> stack = { m_pRoot.get() };
+		while (!stack.empty())
+		{
+			auto pEntity = stack.back();
+			stack.pop_back();
+			pEntity->m_hasChanges = false;
+			pEntity->m_isSaved = true;
+			for (const auto& pChild : pEntity->m_children) stack.push_back(pChild.get());
+		}
+	}
+
+	void Scene::entityChanged(Entity* pEntity)
+	{
+		m_changedEntities.push_back(pEntity->getHandle());
+	}
+
+	// Only the changed entities are serialized, in parallel when there's enough of them
+	Json::Value Scene::takeChanges()
+	{
+		std::vector<Entity*> entities;
+		if (m_pRoot->m_hasChanges) entities.push_back(m_pRoot.get()); // Might not have a handle if it was created before the scene
+		for (const auto& handle : m_changedEntities)
+		{
+			auto pEntity = getEntity(handle);
+			if (!pEntity || pEntity == m_pRoot.get()) continue;
+
+			// Destroyed or detached, it's out of the parent's child order so it goes away on load
+			pEntity->m_hasChanges = false;
+			if (pEntity->isDescendantOf(m_pRoot.get())) entities.push_back(pEntity);
+			else pEntity->m_isSaved = false;
+		}
+		m_pRoot->m_hasChanges = false;
+		m_changedEntities.clear();
+
+		if (entities.empty() && m_destroyedIds.empty()) return Json::Value();
+
+		// Parents before children, so new parents exist when their children are loaded
+		std::vector<std::pair<int, Entity*>> byDepth;
+		byDepth.reserve(entities.size());
+		for (auto pEntity : entities)
+		{
+			int depth = 0;
+			for (auto pParent = pEntity->m_pParent; pParent; pParent = pParent->m_pParent) ++depth;
+			byDepth.push_back({ depth, pEntity });
+		}
+		std::stable_sort(byDepth.begin(), byDepth.end(), [](const std::pair<int, Entity*>& a, const std::pair<int, Entity*>& b) { return a.first < b.first; });
+
+		std::vector<Json::Value> jsons(byDepth.size());
+		auto serializeEntity = [&](int i) { jsons[i] = byDepth[i].second->serializeSelf(false); };
+		const auto& pJobSystem = getJobSystem();
+		if (pJobSystem && (int)byDepth.size() >= Entity::PARALLEL_SERIALIZE_MIN_ENTITIES)
+		{
+			pJobSystem->parallelFor((int)byDepth.size(), serializeEntity, Entity::PARALLEL_SERIALIZE_BATCH_SIZE);
+		}
+		else
+		{
+			for (int i = 0; i < (int)byDepth.size(); ++i)
+				serializeEntity(i);
+		}
+
+		Json::Value changes;
+		Json::Value entitiesJson(Json::arrayValue);
+		for (int i = 0; i < (int)byDepth.size(); ++i)
+		{
+			auto pEntity = byDepth[i].second;
+			auto& json = jsons[i];
+			if (pEntity->m_pParent) json["parent"] = Utils::serializeUInt64(pEntity->m_pParent->id);
+
+			Json::Value childOrderJson(Json::arrayValue);
+			for (const auto& pChild : pEntity->m_children)
+				childOrderJson.append(Utils::serializeUInt64(pChild->id));
+			json["childOrder"] = childOrderJson;
+
+			pEntity->m_isSaved = true;
+			entitiesJson.append(std::move(json));
+		}
+		changes["entities"] = entitiesJson;
+
+		Json::Value destroyedJson(Json::arrayValue);
+		for (auto id : m_destroyedIds)
+			destroyedJson.append(Utils::serializeUInt64(id));
+		changes["destroyed"] = destroyedJson;
+		m_destroyedIds.clear();
+
+		return changes;
+	}
+
+	// Destroyed first, then entities parent before child, then child orders. Children missing
+	// from their parent's order were destroyed or detached when the changes were taken.
+	void Scene::applyChanges(const Json::Value& changes)
+	{
+		for (const auto& idJson : changes["destroyed"])
+		{
+			auto pEntity = findEntity(Utils::deserializeUInt64(idJson));
+			if (pEntity && pEntity != m_pRoot) destroyEntity(pEntity);
+		}
+
+		std::vector<std::pair<EntityRef, const Json::Value*>> childOrders;
+		for (const auto& entityJson : changes["entities"])
+		{
+			auto id = Utils::deserializeUInt64(entityJson["id"]);
+			if (!entityJson.isMember("parent"))
+			{
+				m_pRoot->deserialize(entityJson, false);
+				m_pRoot->clickThrough = true; // We cannot select the root
+				childOrders.push_back({ m_pRoot, &entityJson["childOrder"] });
+				continue;
+			}
+
+			auto parentId = Utils::deserializeUInt64(entityJson["parent"]);
+			auto pParent = parentId == m_pRoot->id ? m_pRoot : findEntity(parentId);
+			if (!pParent)
+			{
+				CORE_ERROR("Saved entity {} has no parent {}", id, parentId);
+				continue;
+			}
+
+			auto pEntity = findEntity(id);
+			if (!pEntity)
+			{
+				pEntity = allocateEntity();
+				pParent->addChild(pEntity);
+			}
+			else if (pEntity->m_pParent != pParent.get())
+			{
+				pParent->addChild(pEntity);
+			}
+			pEntity->deserialize(entityJson, false);
+			childOrders.push_back({ pEntity, &entityJson["childOrder"] });
+		}
+
+		std::vector<EntityRef> unlisted;
+		for (const auto& childOrder : childOrders)
+			childOrder.first->reorderChildren(*childOrder.second, unlisted);
+		destroyEntities(unlisted);
+
+#if defined(DEBUG)
+		CORE_ASSERT(checkEntityIndex(), "Entity id index doesn't match the scene");
+#endif
 	}
 
 	void Scene::clear()
 	{
 		m_isMouseDown = false;
-		m_pMouseDownEntity.reset();
-		m_pMouseHoverEntity.reset();
+		m_mouseDownEntity = EntityHandle();
+		m_mouseHoverEntity = EntityHandle();
 		m_pComponentManager->clear();
+		m_entitiesById.clear();
+		m_entitiesByName.clear();
+		m_entitiesByComponent.clear();
+		for (const auto& pView : m_componentViews) pView->dirty = true; // Kept, gameplay code might hold on to them
+		m_drawList.clear();
+		m_drawListDirty = true;
+		m_pSpatialGrid->clear();
+		m_pTransformSystem->markHierarchyDirty();
+		m_entityPool.clear();
+		ComponentFactory::clearRecycled();
+		m_isTrackingChanges = false;
+		m_changedEntities.clear();
+		m_destroyedIds.clear();
 
 		m_pRoot.reset();
 		m_pRoot = std::make_shared<Entity>();
-		m_pRoot->name = "Root";
+		m_pRoot->setName("Root");
 		m_pRoot->clickThrough = true; // We cannot select the root
 	}
 
 	EntityRef Scene::createEntity()
 	{
-		EntityRef pNewEntity = std::make_shared<Entity>();
+		EntityRef pNewEntity = allocateEntity();
 		pNewEntity->id = ++m_id;
+		indexEntity(pNewEntity.get(), 0);
 		m_pRoot->addChild(pNewEntity);
 		return pNewEntity;
 	}
 
 	EntityRef Scene::createEntity(const EntityRef& pParent)
 	{
-		EntityRef pNewEntity = std::make_shared<Entity>();
+		EntityRef pNewEntity = allocateEntity();
 		pNewEntity->id = ++m_id;
+		indexEntity(pNewEntity.get(), 0);
 		pParent->addChild(pNewEntity);
 		return pNewEntity;
 	}
 
 	EntityRef Scene::createEntityFromJson(const EntityRef& pParent, const Json::Value& json, bool generateNewIds)
 	{
-		EntityRef pNewEntity = std::make_shared<Entity>();
+		EntityRef pNewEntity = allocateEntity();
 		pParent->addChild(pNewEntity);
 		pNewEntity->deserialize(json, true, generateNewIds);
 		if (generateNewIds)
@@ -88,6 +416,37 @@ namespace Engine
 		return pNewEntity;
 	}
 
+	EntityRef Scene::allocateEntity()
+	{
+		if (m_entityPool.empty()) return std::make_shared<Entity>();
+
+		auto pEntity = std::move(m_entityPool.back());
+		m_entityPool.pop_back();
+		pEntity->reuse();
+		return pEntity;
+	}
+
+	void Scene::recycleDestroyedEntities()
+	{
+		for (auto& pEntity : m_entitiesToDestroy) recycleEntity(std::move(pEntity));
+		m_entitiesToDestroy.clear();
+	}
+
+	// Only entities nobody else holds. The rest die the usual way when they're let go.
+	void Scene::recycleEntity(EntityRef pEntity)
+	{
+		if (pEntity.use_count() != 1) return;
+
+		for (auto& pChild : pEntity->m_children)
+		{
+			pChild->m_pParent = nullptr;
+			recycleEntity(std::move(pChild));
+		}
+
+		pEntity->resetForReuse();
+		if ((int)m_entityPool.size() < MAX_POOLED_ENTITIES) m_entityPool.push_back(std::move(pEntity));
+	}
+
 	const ComponentManagerRef& Scene::getComponentManager() const
 	{
 		return m_pComponentManager;
@@ -98,9 +457,58 @@ namespace Engine
 		if (pEntity == m_pRoot)
 			CORE_FATAL("Cannot erase Root entity!");
 
+		if (m_pComponentManager->isInParallelPhase())
+		{
+			m_pComponentManager->deferDestroyEntity(pEntity); // We're on a worker thread
+			return;
+		}
+
 		if (pEntity->getParent())
 			pEntity->getParent()->removeChild(pEntity);
 
+		destroyDetachedEntity(pEntity);
+	}
+
+	void Scene::destroyEntities(const std::vector<EntityRef>& entities)
+	{
+		if (m_pComponentManager->isInParallelPhase())
+		{
+			for (const auto& pEntity : entities)
+				m_pComponentManager->deferDestroyEntity(pEntity); // We're on a worker thread
+			return;
+		}
+
+		std::vector<Entity*> parents;
+		for (const auto& pEntity : entities)
+		{
+			if (pEntity == m_pRoot)
+				CORE_FATAL("Cannot erase Root entity!");
+
+			auto pParent = pEntity->m_pParent;
+			if (!pParent) continue;
+			parents.push_back(pParent);
+			pParent->childDetached(pEntity.get());
+		}
+		std::sort(parents.begin(), parents.end());
+		parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+		for (auto pParent : parents)
+			pParent->removeDetachedChildren();
+
+		for (const auto& pEntity : entities)
+			destroyDetachedEntity(pEntity);
+	}
+
+	void Scene::destroyDetachedEntity(const EntityRef& pEntity)
+	{
+		// Out of the index right away, like it's out of the tree. The entity itself lives until the end of the update
+		std::function<void(Entity*)> unindexRecursive = [&](Entity* pEntity)
+		{
+			if (m_isTrackingChanges && pEntity->m_isSaved) m_destroyedIds.push_back(pEntity->id);
+			unindexEntity(pEntity);
+			for (const auto& pChild : pEntity->getChildren()) unindexRecursive(pChild.get());
+		};
+		unindexRecursive(pEntity.get());
+
 		const auto& components = pEntity->getComponents();
 		for (const auto& pComponent : components)
 			m_pComponentManager->removeComponent(pComponent);
@@ -150,7 +558,239 @@ namespace Engine
     
 	EntityRef Scene::findEntity(uint64_t id)
 	{
-		return findEntity(m_pRoot, id);
+		if (id == m_pRoot->id) return m_pRoot;
+
+		auto it = m_entitiesById.find(id);
+		if (it == m_entitiesById.end()) return nullptr;
+
+		auto pEntity = it->second;
+		if (!pEntity->isDescendantOf(m_pRoot.get())) return nullptr; // Detached, the tree search wouldn't have found it either
+		return pEntity->shared_from_this();
+	}
+
+	void Scene::indexEntity(Entity* pEntity, uint64_t previousId)
+	{
+		auto it = m_entitiesById.find(previousId);
+		if (it != m_entitiesById.end() && it->second == pEntity)
+			m_entitiesById.erase(it);
+
+		m_entitiesById[pEntity->id] = pEntity;
+	}
+
+	void Scene::unindexEntity(Entity* pEntity)
+	{
+		auto it = m_entitiesById.find(pEntity->id);
+		if (it != m_entitiesById.end() && it->second == pEntity)
+			m_entitiesById.erase(it);
+	}
+
+	// Buckets are unordered so removal can swap with the last entity. Entities remember their
+	// position in each bucket, so there's no search. Positions are checked because clear() drops
+	// the buckets without telling entities that are still alive.
+	void Scene::indexEntityName(Entity* pEntity)
+	{
+		if (pEntity->m_sceneNameIndex != -1 || pEntity->name.empty()) return;
+
+		auto& bucket = m_entitiesByName[pEntity->name];
+		pEntity->m_sceneNameIndex = (int)bucket.size();
+		bucket.push_back(pEntity);
+	}
+
+	void Scene::unindexEntityName(Entity* pEntity)
+	{
+		auto index = pEntity->m_sceneNameIndex;
+		pEntity->m_sceneNameIndex = -1;
+		if (index == -1) return;
+
+		auto it = m_entitiesByName.find(pEntity->name);
+		if (it == m_entitiesByName.end()) return;
+		auto& bucket = it->second;
+		if (index >= (int)bucket.size() || bucket[index] != pEntity) return;
+
+		auto pLast = bucket.back();
+		bucket[index] = pLast;
+		pLast->m_sceneNameIndex = index;
+		bucket.pop_back();
+		if (bucket.empty()) m_entitiesByName.erase(it);
+	}
+
+	void Scene::indexEntityComponent(Entity* pEntity, ComponentTypeId typeId)
+	{
+		invalidateViews(typeId);
+		auto& bucket = m_entitiesByComponent[typeId];
+		pEntity->m_sceneComponentIndex.push_back({ typeId, (int)bucket.size() });
+		bucket.push_back(pEntity);
+	}
+
+	void Scene::unindexEntityComponent(Entity* pEntity, ComponentTypeId typeId)
+	{
+		auto findIndex = [typeId](Entity* pEntity)
+		{
+			return std::find_if(pEntity->m_sceneComponentIndex.begin(), pEntity->m_sceneComponentIndex.end(),
+				[typeId](const std::pair<ComponentTypeId, int>& kv) { return kv.first == typeId; });
+		};
+
+		auto entryIt = findIndex(pEntity);
+		if (entryIt == pEntity->m_sceneComponentIndex.end()) return;
+		invalidateViews(typeId);
+		auto index = entryIt->second;
+		pEntity->m_sceneComponentIndex.erase(entryIt);
+
+		auto it = m_entitiesByComponent.find(typeId);
+		if (it == m_entitiesByComponent.end()) return;
+		auto& bucket = it->second;
+		if (index >= (int)bucket.size() || bucket[index] != pEntity) return;
+
+		auto pLast = bucket.back();
+		bucket[index] = pLast;
+		findIndex(pLast)->second = index;
+		bucket.pop_back();
+		if (bucket.empty()) m_entitiesByComponent.erase(it);
+	}
+
+	const std::vector<Entity*>& Scene::getEntitiesByName(const std::string& name) const
+	{
+		static const std::vector<Entity*> EMPTY;
+		auto it = m_entitiesByName.find(name);
+		return it != m_entitiesByName.end() ? it->second : EMPTY;
+	}
+
+	const std::vector<Entity*>& Scene::getEntitiesByComponent(ComponentTypeId typeId) const
+	{
+		static const std::vector<Entity*> EMPTY;
+		auto it = m_entitiesByComponent.find(typeId);
+		return it != m_entitiesByComponent.end() ? it->second : EMPTY;
+	}
+
+	const std::vector<Entity*>& Scene::view(const ComponentTypeId* pTypeIds, int count)
+	{
+		static const std::vector<Entity*> EMPTY;
+		if (count <= 0) return EMPTY;
+
+		std::vector<ComponentTypeId> typeIds(pTypeIds, pTypeIds + count);
+		std::sort(typeIds.begin(), typeIds.end());
+		typeIds.erase(std::unique(typeIds.begin(), typeIds.end()), typeIds.end());
+		if (typeIds.front() == INVALID_COMPONENT_TYPE || typeIds.back() == INVALID_COMPONENT_TYPE) return EMPTY;
+
+		ComponentView* pView = nullptr;
+		for (const auto& pCandidate : m_componentViews)
+		{
+			if (pCandidate->typeIds == typeIds)
+			{
+				pView = pCandidate.get();
+				break;
+			}
+		}
+		if (!pView)
+		{
+			m_componentViews.push_back(std::make_unique<ComponentView>());
+			pView = m_componentViews.back().get();
+			pView->typeIds = typeIds;
+		}
+		if (!pView->dirty) return pView->entities;
+
+		// Walk the smallest membership set, check the others on each entity's mask
+		const std::vector<Entity*>* pSmallest = nullptr;
+		for (auto typeId : typeIds)
+		{
+			const auto& bucket = getEntitiesByComponent(typeId);
+			if (!pSmallest || bucket.size() < pSmallest->size()) pSmallest = &bucket;
+		}
+
+		pView->entities.clear();
+		for (auto pEntity : *pSmallest)
+		{
+			bool matches = pEntity == m_pRoot.get() || pEntity->isDescendantOf(m_pRoot.get());
+			for (size_t i = 0; matches && i < typeIds.size(); ++i)
+				matches = pEntity->hasComponentId(typeIds[i]);
+			if (matches) pView->entities.push_back(pEntity);
+		}
+		pView->dirty = false;
+
+		return pView->entities;
+	}
+
+	void Scene::invalidateViews(ComponentTypeId typeId)
+	{
+		for (const auto& pView : m_componentViews)
+			if (!pView->dirty && std::binary_search(pView->typeIds.begin(), pView->typeIds.end(), typeId))
+				pView->dirty = true;
+	}
+
+	void Scene::entityMoved(Entity* pEntity)
+	{
+		// Nothing to draw until the list is rebuilt, in case it was attached by a draw
+		m_drawListDirty = true;
+		pEntity->m_drawBegin = 0;
+		pEntity->m_drawEnd = 0;
+
+		if (m_componentViews.empty()) return;
+
+		std::vector<Entity*> stack = { pEntity };
+		while (!stack.empty())
+		{
+			auto pCurrent = stack.back();
+			stack.pop_back();
+			for (const auto& kv : pCurrent->m_sceneComponentIndex) invalidateViews(kv.first);
+			for (const auto& pChild : pCurrent->m_children) stack.push_back(pChild.get());
+		}
+	}
+
+	bool Scene::checkEntityIndex() const
+	{
+		bool valid = true;
+
+		for (const auto& kv : m_entitiesById)
+		{
+			if (kv.second->id != kv.first)
+			{
+				CORE_ERROR("Entity index: key {} points to entity {} ({})", kv.first, kv.second->id, kv.second->name);
+				valid = false;
+			}
+		}
+
+		std::function<void(const EntityRef&)> checkRecursive = [&](const EntityRef& pEntity)
+		{
+			if (pEntity != m_pRoot)
+			{
+				auto it = m_entitiesById.find(pEntity->id);
+				if (it == m_entitiesById.end())
+				{
+					CORE_ERROR("Entity index: entity {} ({}) is missing", pEntity->id, pEntity->name);
+					valid = false;
+				}
+				else if (it->second != pEntity.get())
+				{
+					CORE_ERROR("Entity index: id {} is used by more than one entity ({}, {})", pEntity->id, pEntity->name, it->second->name);
+					valid = false;
+				}
+			}
+
+			if (!pEntity->name.empty())
+			{
+				const auto& bucket = getEntitiesByName(pEntity->name);
+				auto index = pEntity->m_sceneNameIndex;
+				if (index < 0 || index >= (int)bucket.size() || bucket[index] != pEntity.get())
+				{
+					CORE_ERROR("Entity index: entity {} ({}) is missing from the name index", pEntity->id, pEntity->name);
+					valid = false;
+				}
+			}
+
+			for (const auto& kv : pEntity->m_sceneComponentIndex)
+			{
+				const auto& bucket = getEntitiesByComponent(kv.first);
+				if (kv.second >= (int)bucket.size() || bucket[kv.second] != pEntity.get())
+				{
+					CORE_ERROR("Entity index: entity {} ({}) is missing from the component index", pEntity->id, pEntity->name);
+					valid = false;
+				}
+			}
+			for (const auto& pChild : pEntity->getChildren()) checkRecursive(pChild);
+		};
+		checkRecursive(m_pRoot);
+
+		return valid;
 	}
     
 	EntityRef Scene::findEntity(const EntityRef& pEntity, uint64_t id)
@@ -171,16 +811,22 @@ namespace Engine
 		destroyEntity(pEntity);
 	}
 
+	EntityRef Scene::getHoveredEntity() const
+	{
+		auto pEntity = getEntity(m_mouseHoverEntity);
+		return pEntity ? pEntity->shared_from_this() : nullptr;
+	}
+
 	void Scene::onMouseDown(IEvent* pEvent)
 	{
 		auto pMouseDown = (MouseButtonDownEvent*)pEvent;
 		if (pMouseDown->button.button == SDL_BUTTON_LEFT)
 		{
 			m_isMouseDown = true;
-			if (m_pMouseHoverEntity)
+			if (auto pHoverEntity = getEntity(m_mouseHoverEntity))
 			{
-				m_pMouseDownEntity = m_pMouseHoverEntity;
-				m_pMouseDownEntity->onMouseDown();
+				m_mouseDownEntity = m_mouseHoverEntity;
+				pHoverEntity->onMouseDown();
 			}
 		}
 	}
@@ -191,48 +837,56 @@ namespace Engine
 		if (pMouseUp->button.button == SDL_BUTTON_LEFT)
 		{
 			m_isMouseDown = false;
-			if (m_pMouseDownEntity)
+			if (auto pMouseDownEntity = getEntity(m_mouseDownEntity))
 			{
-				m_pMouseDownEntity->onMouseUp();
-				if (m_pMouseDownEntity == m_pMouseHoverEntity)
+				pMouseDownEntity->onMouseUp();
+				if (m_mouseDownEntity == m_mouseHoverEntity)
 				{
-					m_pMouseDownEntity->onMouseClick();
+					pMouseDownEntity->onMouseClick();
 				}
 				else
 				{
-					if (m_pMouseHoverEntity)
-						m_pMouseHoverEntity->onMouseEnter();
+					if (auto pHoverEntity = getEntity(m_mouseHoverEntity))
+						pHoverEntity->onMouseEnter();
 				}
-				m_pMouseDownEntity = nullptr;
 			}
+			m_mouseDownEntity = EntityHandle();
 		}
 	}
 
 	void Scene::update(float dt)
 	{
 		m_pComponentManager->update(dt);
-		m_entitiesToDestroy.clear();
+		recycleDestroyedEntities();
+		m_pTransformSystem->update(); // Everything moved for this frame, one pass before picking
+		m_pSpatialGrid->compact();
 
 		// Get the current mouse hover entity (Used by editor, but also gameplay when clicking stuff in UI, or in the world)
-		auto pPreviousHoverEntity = m_pMouseHoverEntity;
-		m_pMouseHoverEntity = m_pRoot->getMouseHover(m_mousePos, isEditorScene());
-		if (m_pMouseHoverEntity == m_pRoot) m_pMouseHoverEntity = nullptr; // We ignore root (In case we're in editor)
+		auto previousHoverEntity = m_mouseHoverEntity;
+		auto pHoverEntity = m_pRoot->getMouseHover(m_mousePos, isEditorScene());
+		if (pHoverEntity == m_pRoot) pHoverEntity = nullptr; // We ignore root (In case we're in editor)
+		m_mouseHoverEntity = pHoverEntity ? pHoverEntity->getHandle() : EntityHandle();
 
 		if (!m_isEditorScene)
 		{
-			if (pPreviousHoverEntity != m_pMouseHoverEntity)
+			if (previousHoverEntity != m_mouseHoverEntity)
 			{
-				if (m_pMouseDownEntity)
+				// Handles of entities destroyed since last frame resolve to nullptr
+				auto pPreviousHoverEntity = getEntity(previousHoverEntity);
+				if (m_mouseDownEntity.isValid())
 				{
-					if (m_pMouseHoverEntity == m_pMouseDownEntity)
-						m_pMouseDownEntity->onMouseEnter();
-					else if (pPreviousHoverEntity == m_pMouseDownEntity)
-						m_pMouseDownEntity->onMouseLeave();
+					if (auto pMouseDownEntity = getEntity(m_mouseDownEntity))
+					{
+						if (m_mouseHoverEntity == m_mouseDownEntity)
+							pMouseDownEntity->onMouseEnter();
+						else if (previousHoverEntity == m_mouseDownEntity)
+							pMouseDownEntity->onMouseLeave();
+					}
 				}
 				else
 				{
 					if (pPreviousHoverEntity) pPreviousHoverEntity->onMouseLeave();
-					if (m_pMouseHoverEntity) m_pMouseHoverEntity->onMouseEnter();
+					if (pHoverEntity) pHoverEntity->onMouseEnter();
 				}
 			}
 		}
@@ -241,11 +895,89 @@ namespace Engine
 	void Scene::fixedUpdate(float dt)
 	{
 		m_pComponentManager->fixedUpdate(dt);
-		m_entitiesToDestroy.clear();
+		recycleDestroyedEntities();
 	}
 
 	void Scene::draw()
 	{
-		m_pRoot->draw();
+		m_pTransformSystem->update();
+
+		// The editor shows disabled and hidden entities, it keeps walking the tree
+		if (m_isEditorScene)
+		{
+			m_pRoot->draw();
+			return;
+		}
+
+		if (m_drawListDirty) rebuildDrawList();
+		drawItems(0, (uint32_t)m_drawList.size());
+	}
+
+	void Scene::rebuildDrawList()
+	{
+		m_drawList.clear();
+		appendDrawItems(m_pRoot.get());
+		m_drawListDirty = false;
+	}
+
+	// Same order Entity::draw paints in. Entities without anything to draw in their subtree are left out
+	void Scene::appendDrawItems(Entity* pEntity)
+	{
+		pEntity->m_drawBegin = (uint32_t)m_drawList.size();
+
+		for (auto rit = pEntity->m_components.rbegin(); rit != pEntity->m_components.rend(); ++rit)
+		{
+			if ((*rit)->m_isDrawable)
+				m_drawList.push_back({ rit->get(), nullptr, 0 });
+		}
+
+		if (!pEntity->m_children.empty())
+		{
+			auto groupIndex = m_drawList.size();
+			m_drawList.push_back({ nullptr, pEntity, 0 });
+			for (const auto& pChild : pEntity->m_children)
+				appendDrawItems(pChild.get());
+
+			if (m_drawList.size() == groupIndex + 1)
+				m_drawList.pop_back();
+			else
+				m_drawList[groupIndex].end = (uint32_t)m_drawList.size();
+		}
+
+		pEntity->m_drawEnd = (uint32_t)m_drawList.size();
+	}
+
+	void Scene::drawItems(uint32_t begin, uint32_t end)
+	{
+		for (auto i = begin; i < end;)
+		{
+			const auto& item = m_drawList[i];
+			if (item.pComponent)
+			{
+				if (item.pComponent->isEnabled()) item.pComponent->draw();
+				++i;
+			}
+			else
+			{
+				// sortChildren is read here, so flipping it doesn't need a rebuild
+				auto pParent = item.pEntity;
+				if (pParent->sortChildren)
+				{
+					for (const auto& sortedChild : pParent->getSortedChildren())
+					{
+						auto pChild = sortedChild.pEntity;
+						if (pChild->enabled) drawItems(pChild->m_drawBegin, pChild->m_drawEnd);
+					}
+				}
+				else
+				{
+					for (const auto& pChild : pParent->m_children)
+					{
+						if (pChild->enabled) drawItems(pChild->m_drawBegin, pChild->m_drawEnd);
+					}
+				}
+				i = item.end;
+			}
+		}
 	}
 }
@@ -0,0 +1,561 @@
+#include "Engine/SceneBinary.h"
+#include "Engine/AssetManifest.h"
+#include "Engine/FileSystem.h"
+#include "Engine/Log.h"
+#include "Engine/ResourceId.h"
+#include "Engine/Utils.h"
+
+#include <fstream>
+
+
+static const uint32_t NO_PARENT = 0xFFFFFFFF;
+static const int MAX_VALUE_DEPTH = 64; // Corrupted files shouldn't blow the stack
+
+// Json values. Numbers take the smallest tag that holds them exactly.
+enum ValueTag : uint8_t
+{
+    TAG_NULL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_INT32,
+    TAG_INT64,
+    TAG_UINT64,
+    TAG_FLOAT,
+    TAG_DOUBLE,
+    TAG_STRING,
+    TAG_ARRAY,
+    TAG_OBJECT
+};
+
+enum EntityFlag : uint16_t
+{
+    FLAG_ENABLED = 1 << 0,
+    FLAG_SORT_CHILDREN = 1 << 1,
+    FLAG_MOUSE_CHILDREN = 1 << 2,
+    FLAG_CLICK_THROUGH = 1 << 3,
+    FLAG_UI_ROOT = 1 << 4,
+    FLAG_LOCK_SCALE = 1 << 5,
+    FLAG_EXPANDED = 1 << 6,
+    FLAG_EDITOR_VISIBLE = 1 << 7,
+    FLAG_EDITOR_LOCKED = 1 << 8
+};
+
+
+namespace Engine
+{
+    uint32_t SceneBinaryWriter::intern(const std::string& str)
+    {
+        auto it = m_stringIndices.find(str);
+        if (it != m_stringIndices.end()) return it->second;
+
+        auto index = (uint32_t)m_strings.size();
+        m_strings.push_back(str);
+        m_stringIndices[str] = index;
+        return index;
+    }
+
+    void SceneBinaryWriter::writeValue(std::vector<uint8_t>& out, const Json::Value& value)
+    {
+        switch (value.type())
+        {
+            case Json::nullValue:
+                write(out, TAG_NULL);
+                break;
+            case Json::booleanValue:
+                write(out, value.asBool() ? TAG_TRUE : TAG_FALSE);
+                break;
+            case Json::intValue:
+                if (value.isInt())
+                {
+                    write(out, TAG_INT32);
+                    write(out, (int32_t)value.asInt());
+                }
+                else
+                {
+                    write(out, TAG_INT64);
+                    write(out, (int64_t)value.asInt64());
+                }
+                break;
+            case Json::uintValue:
+                if (value.isInt())
+                {
+                    write(out, TAG_INT32);
+                    write(out, (int32_t)value.asInt());
+                }
+                else
+                {
+                    write(out, TAG_UINT64);
+                    write(out, (uint64_t)value.asUInt64());
+                }
+                break;
+            case Json::realValue:
+            {
+                auto d = value.asDouble();
+                if ((double)(float)d == d)
+                {
+                    write(out, TAG_FLOAT);
+                    write(out, (float)d);
+                }
+                else
+                {
+                    write(out, TAG_DOUBLE);
+                    write(out, d);
+                }
+                break;
+            }
+            case Json::stringValue:
+                write(out, TAG_STRING);
+                write(out, intern(value.asString()));
+                break;
+            case Json::arrayValue:
+                write(out, TAG_ARRAY);
+                write(out, (uint32_t)value.size());
+                for (const auto& element : value) writeValue(out, element);
+                break;
+            case Json::objectValue:
+                write(out, TAG_OBJECT);
+                write(out, (uint32_t)value.size());
+                for (auto it = value.begin(); it != value.end(); ++it)
+                {
+                    write(out, intern(it.name()));
+                    writeValue(out, *it);
+                }
+                break;
+        }
+    }
+
+    void SceneBinaryWriter::writeEntity(const SceneEntityRecord& record)
+    {
+        uint16_t flags =
+            (record.enabled ? FLAG_ENABLED : 0) |
+            (record.sortChildren ? FLAG_SORT_CHILDREN : 0) |
+            (record.mouseChildren ? FLAG_MOUSE_CHILDREN : 0) |
+            (record.clickThrough ? FLAG_CLICK_THROUGH : 0) |
+            (record.uiRoot ? FLAG_UI_ROOT : 0) |
+            (record.lockScale ? FLAG_LOCK_SCALE : 0) |
+            (record.expanded ? FLAG_EXPANDED : 0) |
+            (record.editorVisible ? FLAG_EDITOR_VISIBLE : 0) |
+            (record.editorLocked ? FLAG_EDITOR_LOCKED : 0);
+
+        write(m_body, record.parent < 0 ? NO_PARENT : (uint32_t)record.parent);
+        write(m_body, record.id);
+        write(m_body, intern(record.name));
+        write(m_body, flags);
+        write(m_body, record.transform.position.x);
+        write(m_body, record.transform.position.y);
+        write(m_body, record.transform.rotation);
+        write(m_body, record.transform.scale.x);
+        write(m_body, record.transform.scale.y);
+        write(m_body, (uint32_t)record.componentCount);
+        ++m_entityCount;
+    }
+
+    void SceneBinaryWriter::writeComponent(const Json::Value& json)
+    {
+        writeValue(m_body, json);
+    }
+
+    void SceneBinaryWriter::finish(std::vector<uint8_t>& out)
+    {
+        // Extras intern strings too, they go before the table is written
+        std::vector<uint8_t> extras;
+        writeValue(extras, m_extras);
+
+        out.clear();
+        write(out, SceneBinary::MAGIC);
+        write(out, SceneBinary::VERSION);
+        write(out, m_sourceHash);
+        write(out, (uint32_t)m_strings.size());
+        write(out, m_entityCount);
+        for (const auto& str : m_strings)
+        {
+            write(out, (uint32_t)str.size());
+            out.insert(out.end(), str.begin(), str.end());
+        }
+        out.insert(out.end(), extras.begin(), extras.end());
+        out.insert(out.end(), m_body.begin(), m_body.end());
+    }
+
+
+    bool SceneBinaryReader::fail()
+    {
+        if (!m_error) CORE_ERROR("Corrupted binary scene");
+        m_error = true;
+        return false;
+    }
+
+    bool SceneBinaryReader::open(const uint8_t* pData, size_t size)
+    {
+        m_pData = pData;
+        m_size = size;
+        m_offset = 0;
+        m_error = false;
+        m_entitiesRead = 0;
+        m_strings.clear();
+
+        uint32_t magic, version, stringCount;
+        if (!read(magic) || magic != SceneBinary::MAGIC) return fail();
+        if (!read(version)) return false;
+        if (version != SceneBinary::VERSION)
+        {
+            CORE_ERROR("Binary scene version {} not supported (expected {})", version, SceneBinary::VERSION);
+            m_error = true;
+            return false;
+        }
+        if (!read(m_sourceHash) || !read(stringCount) || !read(m_entityCount)) return false;
+        if (stringCount > (m_size - m_offset) / sizeof(uint32_t)) return fail();
+
+        m_strings.resize(stringCount);
+        for (auto& str : m_strings)
+        {
+            uint32_t length;
+            if (!read(length) || m_size - m_offset < length) return fail();
+            str.assign((const char*)m_pData + m_offset, length);
+            m_offset += length;
+        }
+
+        return readValue(m_extras, 0);
+    }
+
+    bool SceneBinaryReader::readString(const std::string*& pOut)
+    {
+        if (m_error || !decodeString(m_offset, pOut)) return fail();
+        return true;
+    }
+
+    bool SceneBinaryReader::readValue(Json::Value& out, int depth)
+    {
+        if (m_error || !decodeValue(m_offset, out, depth)) return fail();
+        return true;
+    }
+
+    bool SceneBinaryReader::decodeString(size_t& offset, const std::string*& pOut) const
+    {
+        uint32_t index;
+        if (!readAt(offset, index) || index >= m_strings.size()) return false;
+        pOut = &m_strings[index];
+        return true;
+    }
+
+    bool SceneBinaryReader::decodeValue(size_t& offset, Json::Value& out, int depth) const
+    {
+        if (depth > MAX_VALUE_DEPTH) return false;
+
+        uint8_t tag;
+        if (!readAt(offset, tag)) return false;
+        switch (tag)
+        {
+            case TAG_NULL: out = Json::Value(); return true;
+            case TAG_FALSE: out = false; return true;
+            case TAG_TRUE: out = true; return true;
+            case TAG_INT32: { int32_t v; if (!readAt(offset, v)) return false; out = v; return true; }
+            case TAG_INT64: { int64_t v; if (!readAt(offset, v)) return false; out = (Json::Int64)v; return true; }
+            case TAG_UINT64: { uint64_t v; if (!readAt(offset, v)) return false; out = (Json::UInt64)v; return true; }
+            case TAG_FLOAT: { float v; if (!readAt(offset, v)) return false; out = (double)v; return true; }
+            case TAG_DOUBLE: { double v; if (!readAt(offset, v)) return false; out = v; return true; }
+            case TAG_STRING:
+            {
+                const std::string* pStr;
+                if (!decodeString(offset, pStr)) return false;
+                out = *pStr;
+                return true;
+            }
+            case TAG_ARRAY:
+            {
+                uint32_t count;
+                if (!readAt(offset, count)) return false;
+                if (count > m_size - offset) return false; // Every element is at least a byte
+                out = Json::Value(Json::arrayValue);
+                out.resize(count);
+                for (uint32_t i = 0; i < count; ++i)
+                    if (!decodeValue(offset, out[i], depth + 1)) return false;
+                return true;
+            }
+            case TAG_OBJECT:
+            {
+                uint32_t count;
+                if (!readAt(offset, count)) return false;
+                out = Json::Value(Json::objectValue);
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    const std::string* pKey;
+                    if (!decodeString(offset, pKey)) return false;
+                    if (!decodeValue(offset, out[*pKey], depth + 1)) return false;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Same walk as decodeValue, without building anything
+    bool SceneBinaryReader::skipValue(size_t& offset, int depth) const
+    {
+        if (depth > MAX_VALUE_DEPTH) return false;
+
+        uint8_t tag;
+        if (!readAt(offset, tag)) return false;
+
+        size_t size = 0;
+        switch (tag)
+        {
+            case TAG_NULL: case TAG_FALSE: case TAG_TRUE: return true;
+            case TAG_INT32: size = sizeof(int32_t); break;
+            case TAG_INT64: size = sizeof(int64_t); break;
+            case TAG_UINT64: size = sizeof(uint64_t); break;
+            case TAG_FLOAT: size = sizeof(float); break;
+            case TAG_DOUBLE: size = sizeof(double); break;
+            case TAG_STRING:
+            {
+                const std::string* pStr;
+                return decodeString(offset, pStr);
+            }
+            case TAG_ARRAY:
+            {
+                uint32_t count;
+                if (!readAt(offset, count)) return false;
+                if (count > m_size - offset) return false;
+                for (uint32_t i = 0; i < count; ++i)
+                    if (!skipValue(offset, depth + 1)) return false;
+                return true;
+            }
+            case TAG_OBJECT:
+            {
+                uint32_t count;
+                if (!readAt(offset, count)) return false;
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    const std::string* pKey;
+                    if (!decodeString(offset, pKey)) return false;
+                    if (!skipValue(offset, depth + 1)) return false;
+                }
+                return true;
+            }
+            default: return false;
+        }
+
+        if (m_size - offset < size) return false;
+        offset += size;
+        return true;
+    }
+
+    bool SceneBinaryReader::readEntity(SceneEntityRecord& out)
+    {
+        if (m_error || m_entitiesRead >= m_entityCount) return false;
+
+        uint32_t parent, componentCount;
+        uint16_t flags;
+        const std::string* pName;
+        if (!read(parent) || !read(out.id) || !readString(pName) || !read(flags)) return false;
+        if (!read(out.transform.position.x) || !read(out.transform.position.y) || !read(out.transform.rotation)) return false;
+        if (!read(out.transform.scale.x) || !read(out.transform.scale.y) || !read(componentCount)) return false;
+
+        // Parents come first, anything else means the file is broken
+        if (parent != NO_PARENT && parent >= m_entitiesRead) return fail();
+        if (parent == NO_PARENT && m_entitiesRead != 0) return fail();
+
+        out.parent = parent == NO_PARENT ? -1 : (int)parent;
+        out.name = *pName;
+        out.enabled = (flags & FLAG_ENABLED) != 0;
+        out.sortChildren = (flags & FLAG_SORT_CHILDREN) != 0;
+        out.mouseChildren = (flags & FLAG_MOUSE_CHILDREN) != 0;
+        out.clickThrough = (flags & FLAG_CLICK_THROUGH) != 0;
+        out.uiRoot = (flags & FLAG_UI_ROOT) != 0;
+        out.lockScale = (flags & FLAG_LOCK_SCALE) != 0;
+        out.expanded = (flags & FLAG_EXPANDED) != 0;
+        out.editorVisible = (flags & FLAG_EDITOR_VISIBLE) != 0;
+        out.editorLocked = (flags & FLAG_EDITOR_LOCKED) != 0;
+        out.componentCount = (int)componentCount;
+
+        ++m_entitiesRead;
+        return true;
+    }
+
+    bool SceneBinaryReader::readComponent(Json::Value& out)
+    {
+        if (m_error) return false;
+        return readValue(out, 0);
+    }
+
+    bool SceneBinaryReader::skipComponent(size_t& outOffset)
+    {
+        if (m_error) return false;
+        outOffset = m_offset;
+        if (!skipValue(m_offset, 0)) return fail();
+        return true;
+    }
+
+    bool SceneBinaryReader::decodeComponent(size_t offset, Json::Value& out) const
+    {
+        return decodeValue(offset, out, 0);
+    }
+
+
+    namespace SceneBinary
+    {
+        std::string getBinaryFilename(const std::string& jsonFilename)
+        {
+            return Utils::getPathWithoutExtension(jsonFilename) + ".rscene";
+        }
+
+        bool isBinary(const uint8_t* pData, size_t size)
+        {
+            uint32_t magic;
+            if (size < sizeof(magic)) return false;
+            memcpy(&magic, pData, sizeof(magic));
+            return magic == MAGIC;
+        }
+
+        uint64_t getSourceHash(const uint8_t* pData, size_t size)
+        {
+            // Magic, version, then the hash
+            uint64_t sourceHash;
+            if (!isBinary(pData, size) || size < 8 + sizeof(sourceHash)) return 0;
+            memcpy(&sourceHash, pData + 8, sizeof(sourceHash));
+            return sourceHash;
+        }
+
+        static void readEntityJson(const Json::Value& json, int parent, SceneEntityRecord& out)
+        {
+            Entity::readRecord(json, out);
+            out.parent = parent;
+        }
+
+        static Json::Value writeEntityJson(const SceneEntityRecord& record)
+        {
+            Json::Value json;
+            Entity::writeRecord(record, json);
+            json["components"] = Json::Value(Json::arrayValue);
+            json["children"] = Json::Value(Json::arrayValue);
+            return json;
+        }
+
+        static bool writeScene(const Json::Value& sceneJson, const AssetManifest* pManifest, uint64_t sourceHash, std::vector<uint8_t>& out)
+        {
+            if (!sceneJson["root"].isObject())
+            {
+                CORE_ERROR("Scene json has no root");
+                return false;
+            }
+
+            SceneBinaryWriter writer;
+            writer.setSourceHash(sourceHash);
+
+            Json::Value extras;
+            for (auto it = sceneJson.begin(); it != sceneJson.end(); ++it)
+                if (it.name() != "root") extras["scene"][it.name()] = *it;
+            if (pManifest) extras["manifest"] = pManifest->serialize();
+            writer.setExtras(extras);
+
+            // Parent before child, with the index each entity gets
+            std::vector<std::pair<const Json::Value*, int>> stack = { { &sceneJson["root"], -1 } };
+            int index = 0;
+            SceneEntityRecord record;
+            while (!stack.empty())
+            {
+                auto pJson = stack.back().first;
+                readEntityJson(*pJson, stack.back().second, record);
+                stack.pop_back();
+
+                writer.writeEntity(record);
+                for (const auto& componentJson : (*pJson)["components"])
+                    writer.writeComponent(componentJson);
+
+                const auto& childrenJson = (*pJson)["children"];
+                for (int i = (int)childrenJson.size() - 1; i >= 0; --i)
+                    stack.push_back({ &childrenJson[i], index });
+                ++index;
+            }
+
+            writer.finish(out);
+            return true;
+        }
+
+        bool fromJson(const Json::Value& sceneJson, std::vector<uint8_t>& out, uint64_t sourceHash)
+        {
+            return writeScene(sceneJson, nullptr, sourceHash, out);
+        }
+
+        bool toJson(const uint8_t* pData, size_t size, Json::Value& out)
+        {
+            SceneBinaryReader reader;
+            if (!reader.open(pData, size)) return false;
+
+            std::vector<Json::Value> entities;
+            std::vector<std::vector<int>> children;
+            entities.reserve(reader.getEntityCount());
+            children.reserve(reader.getEntityCount());
+
+            SceneEntityRecord record;
+            while (reader.readEntity(record))
+            {
+                auto json = writeEntityJson(record);
+                for (int i = 0; i < record.componentCount; ++i)
+                {
+                    Json::Value componentJson;
+                    if (!reader.readComponent(componentJson)) return false;
+                    json["components"].append(componentJson);
+                }
+
+                if (record.parent != -1) children[record.parent].push_back((int)entities.size());
+                entities.push_back(std::move(json));
+                children.emplace_back();
+            }
+            if (reader.hasError() || entities.empty()) return false;
+
+            // Children always come after their parent, so going backward they're complete when moved in
+            for (int i = (int)entities.size() - 1; i >= 0; --i)
+                for (auto child : children[i])
+                    entities[i]["children"].append(std::move(entities[child]));
+
+            out = reader.getExtras()["scene"];
+            if (!out.isObject()) out = Json::Value(Json::objectValue);
+            out["root"] = std::move(entities[0]);
+            return true;
+        }
+
+        // The manifest goes in the extras, so loading a cooked scene doesn't need to scan anything
+        bool cook(const uint8_t* pJsonData, size_t size, std::vector<uint8_t>& out)
+        {
+            Json::Value json;
+            Json::CharReaderBuilder builder;
+            std::unique_ptr<Json::CharReader> pReader(builder.newCharReader());
+            if (!pReader->parse((const char*)pJsonData, (const char*)pJsonData + size, &json, nullptr)) return false;
+            if (!json.isObject() || !json["root"].isObject()) return false; // Some other json
+
+            auto manifest = AssetManifest::scan(json);
+            manifest.sourceHash = hashBytes(pJsonData, size);
+            return writeScene(json, &manifest, manifest.sourceHash, out);
+        }
+
+        bool convertFile(const std::string& jsonFilename, const std::string& binaryFilename)
+        {
+            FileSystem::FileData fileData;
+            if (!FileSystem::readFile(jsonFilename, fileData))
+            {
+                CORE_ERROR("Failed to load file: {}", jsonFilename);
+                return false;
+            }
+
+            std::vector<uint8_t> data;
+            if (!cook(fileData.pData, fileData.size, data))
+            {
+                CORE_ERROR("Not a scene: {}", jsonFilename);
+                return false;
+            }
+            return saveFile(data, binaryFilename);
+        }
+
+        bool saveFile(const std::vector<uint8_t>& data, const std::string& filename)
+        {
+            std::ofstream file(filename, std::ios::binary);
+            if (!file.is_open())
+            {
+                CORE_ERROR("Failed to save file: {}", filename);
+                return false;
+            }
+            file.write((const char*)data.data(), data.size());
+            return true;
+        }
+    }
+}
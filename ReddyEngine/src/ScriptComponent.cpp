@@ -5,6 +5,7 @@ extern "C" {
 }
 
 #include "Engine/ScriptComponent.h"
+#include "Engine/Entity.h"
 #include "Engine/LuaBindings.h"
 #include "Engine/ReddyEngine.h"
 #include "Engine/GUI.h"
@@ -91,6 +92,7 @@ namespace Engine
         Component::deserialize(json);
 
         name = json["name"].asString();
+        updateNameId();
 
         m_pLuaComponentDef = getLuaBindings()->getComponentDef(name);
         if (!m_pLuaComponentDef)
@@ -178,12 +180,22 @@ namespace Engine
         if (m_pLuaComponentDef) return;
 
         m_pLuaComponentDef = pDef;
+        updateNameId();
         createLuaObj();
         m_luaProperties.clear();
         if (m_pLuaComponentDef)
             m_luaProperties = m_pLuaComponentDef->properties;
     }
 
+    void ScriptComponent::updateNameId()
+    {
+        auto nameId = name.empty() ? getTypeId() : ComponentFactory::internName(name);
+        if (nameId == m_nameId) return;
+
+        m_nameId = nameId;
+        if (m_pEntity) m_pEntity->componentNameChanged();
+    }
+
     bool ScriptComponent::edit()
     {
         bool changed = false;
@@ -191,6 +203,7 @@ namespace Engine
         if (GUI::stringProperty("Component Name", &name, "Changing this will reset all properties values. Lua scripts should call RegisterComponent(\"name\")."))
         {
             changed = true;
+            updateNameId();
             m_pLuaComponentDef = getLuaBindings()->getComponentDef(name);
             m_luaProperties.clear();
             if (m_pLuaComponentDef)
@@ -235,7 +248,11 @@ namespace Engine
 
     void ScriptComponent::createLuaObj()
     {
-        if (!m_pLuaComponentDef) return;
+        if (!m_pLuaComponentDef)
+        {
+            setUpdatePhases(0); // Nothing to call
+            return;
+        }
 
         auto L = getLuaBindings()->getState();
 
@@ -254,10 +271,20 @@ namespace Engine
         lua_getfield(L, -1, "mouseUp"); if (lua_isfunction(L, -1)) m_implLuaCallsMask |= LUA_FLAG_MOUSEUP; lua_pop(L, 1);
         lua_getfield(L, -1, "mouseClick"); if (lua_isfunction(L, -1)) m_implLuaCallsMask |= LUA_FLAG_MOUSECLICK; lua_pop(L, 1);
 
+        setUpdatePhases(((m_implLuaCallsMask & LUA_FLAG_UPDATE) ? 1 << UPDATE_PHASE_UPDATE : 0) |
+                        ((m_implLuaCallsMask & LUA_FLAG_FIXEDUPDATE) ? 1 << UPDATE_PHASE_FIXED_UPDATE : 0));
+
+        // Optional tick policy, declared on the component: tickInterval, offscreenTickInterval, dormantDistance
+        TickPolicy tickPolicy;
+        lua_getfield(L, -1, "tickInterval"); if (lua_isnumber(L, -1)) tickPolicy.interval = (int)lua_tointeger(L, -1); lua_pop(L, 1);
+        lua_getfield(L, -1, "offscreenTickInterval"); if (lua_isnumber(L, -1)) tickPolicy.offscreenInterval = (int)lua_tointeger(L, -1); lua_pop(L, 1);
+        lua_getfield(L, -1, "dormantDistance"); if (lua_isnumber(L, -1)) tickPolicy.dormantDistance = (float)lua_tonumber(L, -1); lua_pop(L, 1);
+        setTickPolicy(tickPolicy);
+
         LUA_CLONE_TABLE(L, lua_gettop(L));
 
-        // Add pointer to our script component
-        lua_pushlightuserdata(L, this);
+        // Add handle to our script component
+        lua_pushlightuserdata(L, getHandle().toUserData());
         lua_setfield(L, -2, "COBJ");
 
         lua_setfield(L, -3, luaName.c_str());
@@ -369,7 +396,7 @@ namespace Engine
         lua_pop(L, lua_gettop(L));
     }
 
-	void ScriptComponent::update(float dt)
+	void ScriptComponent::update(float dt) // Time since our last update, more than a frame when our tick policy throttles us
     {
         if (!(m_implLuaCallsMask & LUA_FLAG_UPDATE)) return;
 
@@ -1,6 +1,7 @@
 #include "Engine/Sound.h"
 #include "Engine/Audio.h"
 #include "Engine/Config.h"
+#include "Engine/FileSystem.h"
 #include "Engine/Log.h"
 #include "Engine/ReddyEngine.h"
 #include "Engine/Utils.h"
@@ -39,13 +40,26 @@ namespace Engine
             Extensible = 0xFFFE
         };
 
-        FILE* pFic = fopen(filename.c_str(), "rb");
-        if (!pFic)
+        FileSystem::FileData fileData;
+        if (!FileSystem::readFile(filename, fileData))
         {
             CORE_ERROR("Failed to load " + filename);
             return nullptr;
         }
 
+        // Parse straight from memory, the file might come from a pack
+        size_t cursor = 0;
+        auto read = [&](void* pDst, size_t size)
+        {
+            size = std::min(size, fileData.size - cursor);
+            memcpy(pDst, fileData.pData + cursor, size);
+            cursor += size;
+        };
+        auto skip = [&](long size)
+        {
+            cursor = std::min(cursor + (size_t)std::max(0L, size), fileData.size);
+        };
+
         int32_t chunkid = 0;
         int32_t formatsize;
         WavFormat format;
@@ -66,44 +80,44 @@ namespace Engine
         float* pBuffer = nullptr;
 
         bool datachunk = false;
-        while (!datachunk)
+        while (!datachunk && cursor < fileData.size)
         {
-            fread(&chunkid, 4, 1, pFic);
+            read(&chunkid, 4);
             switch ((WavChunks)chunkid)
             {
                 case WavChunks::Format:
                 {
-                    fread(&formatsize, 4, 1, pFic);
+                    read(&formatsize, 4);
                     int16_t format16;
-                    fread(&format16, 2, 1, pFic);
+                    read(&format16, 2);
                     format = (WavFormat)format16;
-                    fread(&channels, 2, 1, pFic);
+                    read(&channels, 2);
                     channelcount = (int)channels;
-                    fread(&samplerate, 4, 1, pFic);
-                    fread(&bitspersecond, 4, 1, pFic);
-                    fread(&formatblockalign, 2, 1, pFic);
-                    fread(&bitdepth, 2, 1, pFic);
+                    read(&samplerate, 4);
+                    read(&bitspersecond, 4);
+                    read(&formatblockalign, 2);
+                    read(&bitdepth, 2);
                     if (formatsize == 18)
                     {
                         int16_t extradata;
-                        fread(&extradata, 2, 1, pFic);
-                        fseek(pFic, (long)extradata, SEEK_CUR);
+                        read(&extradata, 2);
+                        skip((long)extradata);
                     }
                     break;
                 }
                 case WavChunks::RiffHeader:
                 {
                     headerid = chunkid;
-                    fread(&memsize, 4, 1, pFic);
-                    fread(&riffstyle, 4, 1, pFic);
+                    read(&memsize, 4);
+                    read(&riffstyle, 4);
                     break;
                 }
                 case WavChunks::Data:
                 {
                     datachunk = true;
-                    fread(&datasize, 4, 1, pFic);
+                    read(&datasize, 4);
                     uint8_t* pData = new uint8_t[datasize];
-                    fread(pData, bitdepth / 8, datasize / (bitdepth / 8), pFic);
+                    read(pData, datasize);
 
                     frameCount = (int)datasize / ((int)bitdepth / 8) / channelcount;
 
@@ -165,15 +179,13 @@ namespace Engine
                 default:
                 {
                     int32_t skipsize;
-                    fread(&skipsize, 4, 1, pFic);
-                    fseek(pFic, (long)skipsize, SEEK_CUR);
+                    read(&skipsize, 4);
+                    skip((long)skipsize);
                     break;
                 }
             }
         }
 
-        fclose(pFic);
-
         if (!pBuffer) return nullptr;
         auto pRet = createFromData(pBuffer, frameCount, channelcount, samplerate);
         delete[] pBuffer;
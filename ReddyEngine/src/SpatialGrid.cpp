@@ -0,0 +1,171 @@
+#include "Engine/SpatialGrid.h"
+#include "Engine/Entity.h"
+#include "Engine/Scene.h"
+#include "Engine/TransformSystem.h"
+
+#include <cmath>
+
+
+namespace Engine
+{
+    SpatialGrid::SpatialGrid(Scene* pScene, float cellSize)
+        : m_pScene(pScene)
+        , m_cellSize(cellSize)
+        , m_invCellSize(1.0f / cellSize)
+    {
+    }
+
+    void SpatialGrid::clear()
+    {
+        // Entities can outlive the clear (Lua holding them), don't leave them pointing in cells that are gone
+        for (const auto& kv : m_cells)
+            for (auto pEntity : kv.second)
+                pEntity->m_spatialIndex = -1;
+        for (auto packed : m_dirty)
+            if (auto pEntity = m_pScene->getEntity(EntityHandle::fromUserData((void*)(uintptr_t)packed)))
+                pEntity->m_spatialDirty = false;
+
+        m_cells.clear();
+        m_dirty.clear();
+    }
+
+    void SpatialGrid::markDirty(Entity* pEntity)
+    {
+        if (pEntity->m_spatialDirty) return;
+        pEntity->m_spatialDirty = true;
+        m_dirty.push_back((uint64_t)(uintptr_t)pEntity->getHandle().toUserData());
+    }
+
+    void SpatialGrid::remove(Entity* pEntity)
+    {
+        removeFromCell(pEntity);
+        pEntity->m_spatialDirty = false; // Its handle in m_dirty won't resolve anymore
+    }
+
+    void SpatialGrid::compact()
+    {
+        int count = 0;
+        for (auto packed : m_dirty)
+        {
+            auto pEntity = m_pScene->getEntity(EntityHandle::fromUserData((void*)(uintptr_t)packed));
+            if (pEntity && pEntity->m_spatialDirty) m_dirty[count++] = packed;
+        }
+        m_dirty.resize(count);
+    }
+
+    glm::ivec2 SpatialGrid::getCellCoords(const glm::vec2& position) const
+    {
+        return glm::ivec2((int)std::floor(position.x * m_invCellSize), (int)std::floor(position.y * m_invCellSize));
+    }
+
+    void SpatialGrid::flush()
+    {
+        m_pScene->getTransformSystem()->update(); // Entities get queued as their world transform is recomputed
+
+        for (size_t i = 0; i < m_dirty.size(); ++i)
+        {
+            auto pEntity = m_pScene->getEntity(EntityHandle::fromUserData((void*)(uintptr_t)m_dirty[i]));
+            if (!pEntity || !pEntity->m_spatialDirty) continue; // Destroyed, or removed since
+
+            pEntity->m_spatialDirty = false;
+
+            auto coords = getCellCoords(pEntity->getWorldPosition());
+            auto key = getCellKey(coords.x, coords.y);
+            if (pEntity->m_spatialIndex != -1 && pEntity->m_spatialCell == key) continue; // Didn't leave its cell
+
+            removeFromCell(pEntity);
+            insert(pEntity, key);
+        }
+        m_dirty.clear();
+    }
+
+    void SpatialGrid::insert(Entity* pEntity, CellKey key)
+    {
+        auto& cell = m_cells[key];
+        pEntity->m_spatialCell = key;
+        pEntity->m_spatialIndex = (int)cell.size();
+        cell.push_back(pEntity);
+    }
+
+    void SpatialGrid::removeFromCell(Entity* pEntity)
+    {
+        if (pEntity->m_spatialIndex == -1) return;
+
+        auto index = pEntity->m_spatialIndex;
+        pEntity->m_spatialIndex = -1;
+
+        auto it = m_cells.find(pEntity->m_spatialCell);
+        if (it == m_cells.end()) return;
+        auto& cell = it->second;
+        if (index >= (int)cell.size() || cell[index] != pEntity) return; // Stale
+
+        cell[index] = cell.back();
+        cell[index]->m_spatialIndex = index;
+        cell.pop_back();
+        if (cell.empty()) m_cells.erase(it);
+    }
+
+    template<typename Fn>
+    void SpatialGrid::forEachCell(const glm::vec2& min, const glm::vec2& max, Fn fn)
+    {
+        auto from = getCellCoords(min);
+        auto to = getCellCoords(max);
+
+        // Huge query on a sparse grid, cheaper to look at what's there
+        auto rangeCount = (uint64_t)(to.x - from.x + 1) * (uint64_t)(to.y - from.y + 1);
+        if (rangeCount > (uint64_t)m_cells.size())
+        {
+            for (const auto& kv : m_cells)
+            {
+                auto x = (int)(uint32_t)(kv.first >> 32);
+                auto y = (int)(uint32_t)(kv.first & 0xFFFFFFFF);
+                if (x >= from.x && x <= to.x && y >= from.y && y <= to.y)
+                    fn(kv.second);
+            }
+            return;
+        }
+
+        for (int y = from.y; y <= to.y; ++y)
+        {
+            for (int x = from.x; x <= to.x; ++x)
+            {
+                auto it = m_cells.find(getCellKey(x, y));
+                if (it != m_cells.end()) fn(it->second);
+            }
+        }
+    }
+
+    void SpatialGrid::queryRadius(const glm::vec2& center, float radius, std::vector<Entity*>& out, bool inclusive)
+    {
+        flush();
+
+        auto radiusSq = radius * radius;
+        forEachCell(center - radius, center + radius, [&](const std::vector<Entity*>& cell)
+        {
+            for (auto pEntity : cell)
+            {
+                auto d = pEntity->getWorldPosition() - center;
+                auto distSq = d.x * d.x + d.y * d.y;
+                if (inclusive ? distSq <= radiusSq : distSq < radiusSq)
+                    out.push_back(pEntity);
+            }
+        });
+    }
+
+    void SpatialGrid::queryRect(const glm::vec4& rect, std::vector<Entity*>& out)
+    {
+        flush();
+
+        glm::vec2 min(rect.x, rect.y);
+        glm::vec2 max(rect.x + rect.z, rect.y + rect.w);
+        forEachCell(min, max, [&](const std::vector<Entity*>& cell)
+        {
+            for (auto pEntity : cell)
+            {
+                auto pos = pEntity->getWorldPosition();
+                if (pos.x >= min.x && pos.x <= max.x && pos.y >= min.y && pos.y <= max.y)
+                    out.push_back(pEntity);
+            }
+        });
+    }
+}
@@ -279,7 +279,7 @@ namespace Engine
     }
 
     void SpriteBatch::drawSprite(const TextureRef& pTexture, // nullptr for 1x1 white
-                                 const glm::mat4& transform, 
+                                 const Transform2D& transform, 
                                  const glm::vec4& color, 
                                  const glm::vec2& scale, 
                                  const glm::vec2& origin, 
@@ -302,19 +302,19 @@ namespace Engine
         glm::vec2 invOrigin(1.f - origin.x, 1.f - origin.y);
 
         Vertex* pVerts = m_vertices + (m_spriteCount * 4);
-        pVerts[0].position = transform * glm::vec4(-sizef.x * origin.x, -sizef.y * origin.y, 0, 1);
+        pVerts[0].position = transform * glm::vec2(-sizef.x * origin.x, -sizef.y * origin.y);
         pVerts[0].texCoord = {uvs.x, uvs.y};
         pVerts[0].color = color;
 
-        pVerts[1].position = transform * glm::vec4(-sizef.x * origin.x, sizef.y * invOrigin.y, 0, 1);
+        pVerts[1].position = transform * glm::vec2(-sizef.x * origin.x, sizef.y * invOrigin.y);
         pVerts[1].texCoord = {uvs.x, uvs.w};
         pVerts[1].color = color;
 
-        pVerts[2].position = transform * glm::vec4(sizef.x * invOrigin.x, sizef.y * invOrigin.y, 0, 1);
+        pVerts[2].position = transform * glm::vec2(sizef.x * invOrigin.x, sizef.y * invOrigin.y);
         pVerts[2].texCoord = {uvs.z, uvs.w};
         pVerts[2].color = color;
 
-        pVerts[3].position = transform * glm::vec4(sizef.x * invOrigin.x, -sizef.y * origin.y, 0, 1);
+        pVerts[3].position = transform * glm::vec2(sizef.x * invOrigin.x, -sizef.y * origin.y);
         pVerts[3].texCoord = {uvs.z, uvs.y};
         pVerts[3].color = color;
 
@@ -327,7 +327,7 @@ namespace Engine
     }
 
     void SpriteBatch::drawSlice9Sprite(const TextureRef& pTexture, // nullptr for 1x1 white
-                                 const glm::mat4& transform, 
+                                 const Transform2D& transform, 
                                  const glm::vec4& color, 
                                  const glm::vec2& scale, 
                                  const glm::vec2& origin, 
@@ -376,19 +376,19 @@ namespace Engine
         Vertex* pVerts = m_vertices + (m_spriteCount * 4);
 
 #define DRAW_SLICE(h, v, u0, v0, u1, v1) \
-        pVerts[0].position = transform * glm::vec4(hSlices[h], vSlices[v], 0, 1); \
+        pVerts[0].position = transform * glm::vec2(hSlices[h], vSlices[v]); \
         pVerts[0].texCoord = {u0, v0}; \
         pVerts[0].color = color; \
         \
-        pVerts[1].position = transform * glm::vec4(hSlices[h], vSlices[v + 1], 0, 1); \
+        pVerts[1].position = transform * glm::vec2(hSlices[h], vSlices[v + 1]); \
         pVerts[1].texCoord = {u0, v1}; \
         pVerts[1].color = color; \
         \
-        pVerts[2].position = transform * glm::vec4(hSlices[h + 1], vSlices[v + 1], 0, 1); \
+        pVerts[2].position = transform * glm::vec2(hSlices[h + 1], vSlices[v + 1]); \
         pVerts[2].texCoord = {u1, v1}; \
         pVerts[2].color = color; \
         \
-        pVerts[3].position = transform * glm::vec4(hSlices[h + 1], vSlices[v], 0, 1); \
+        pVerts[3].position = transform * glm::vec2(hSlices[h + 1], vSlices[v]); \
         pVerts[3].texCoord = {u1, v0}; \
         pVerts[3].color = color; \
         \
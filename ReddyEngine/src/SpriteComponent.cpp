@@ -70,7 +70,7 @@ namespace Engine
         glm::vec2 sizef = glm::vec2((float)textureSize.x, (float)textureSize.y) * SPRITE_BASE_SCALE;
         glm::vec2 invOrigin(1.f - origin.x, 1.f - origin.y);
 
-        glm::vec2 localMouse = invTransform * glm::vec4(mousePos, 0, 1);
+        glm::vec2 localMouse = invTransform * mousePos;
 
         return 
             localMouse.x >= -sizef.x * origin.x &&
@@ -89,10 +89,10 @@ namespace Engine
         glm::vec2 invOrigin(1.f - origin.x, 1.f - origin.y);
 
         glm::vec2 points[4] = {
-            transform * glm::vec4(-sizef.x * origin.x, -sizef.y * origin.y, 0, 1),
-            transform * glm::vec4(-sizef.x * origin.x, sizef.y * invOrigin.y, 0, 1),
-            transform * glm::vec4(sizef.x * invOrigin.x, sizef.y * invOrigin.y, 0, 1),
-            transform * glm::vec4(sizef.x * invOrigin.x, -sizef.y * origin.y, 0, 1)
+            transform * glm::vec2(-sizef.x * origin.x, -sizef.y * origin.y),
+            transform * glm::vec2(-sizef.x * origin.x, sizef.y * invOrigin.y),
+            transform * glm::vec2(sizef.x * invOrigin.x, sizef.y * invOrigin.y),
+            transform * glm::vec2(sizef.x * invOrigin.x, -sizef.y * origin.y)
         };
 
 		sb->drawLine(points[0], points[1], 2.0f * zoomScale, color);
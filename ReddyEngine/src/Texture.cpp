@@ -1,57 +1,370 @@
 #include "Engine/Texture.h"
+#include "Engine/FileSystem.h"
+#include "Engine/JobSystem.h"
 #include "Engine/Log.h"
+#include "Engine/ReddyEngine.h"
 #include "Engine/Utils.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+
+static const uint32_t THUMBNAIL_MAGIC = 0x42485452; // "RTHB"
+static const int STREAMING_TILE_SIZE = 256;
+
 
 namespace Engine
 {
+    struct ThumbnailHeader
+    {
+        uint32_t magic;
+        int32_t level; // Mip level of the full texture the thumbnail is
+        int32_t width;
+        int32_t height;
+    };
+
+
+    struct TextureStream
+    {
+        std::weak_ptr<Texture> pTexture;
+        std::string filename;
+        glm::ivec2 size;
+        int mipCount = 1;
+        int thumbnailLevel = -1; // -1 until a thumbnail is up
+
+        // Written by the decode job, read once decoded is set
+        std::atomic<bool> decoded{ false };
+        bool failed = false;
+        std::vector<uint8_t> pixels;
+        std::vector<TextureMipLevel> mips; // Level 1 and up
+
+        int nextTile = 0;
+        int nextMip = 1;
+    };
+
+    static std::vector<std::shared_ptr<TextureStream>> s_streams;
+    static size_t s_streamingBudget = TEXTURE_STREAMING_DEFAULT_BUDGET;
+
+
+    static bool decodeMemory(const uint8_t* pData, size_t size, glm::ivec2& outSize, std::vector<uint8_t>& outPixels)
+    {
+        int w, h, n;
+        auto image = stbi_load_from_memory(pData, (int)size, &w, &h, &n, 4);
+        if (!image) return false;
+        outSize = { w, h };
+
+        // Pre multiplied
+        auto len = outSize.x * outSize.y;
+        outPixels.assign(image, image + len * 4);
+        stbi_image_free(image);
+
+        uint8_t* pImageData = outPixels.data();
+        for (decltype(len) i = 0; i < len; ++i, pImageData += 4)
+        {
+            pImageData[0] = pImageData[0] * pImageData[3] / 255;
+            pImageData[1] = pImageData[1] * pImageData[3] / 255;
+            pImageData[2] = pImageData[2] * pImageData[3] / 255;
+        }
+
+        return true;
+    }
+
+    static int getMipCount(const glm::ivec2& size)
+    {
+        return 1 + (int)std::floor(std::log2((float)std::max(size.x, size.y)));
+    }
+
+    static glm::ivec2 getMipSize(const glm::ivec2& size, int level)
+    {
+        return { std::max(1, size.x >> level), std::max(1, size.y >> level) };
+    }
+
+    // First level small enough to be a thumbnail
+    static int getThumbnailLevel(const glm::ivec2& size)
+    {
+        int level = 0;
+        while (std::max(size.x >> level, size.y >> level) > TEXTURE_THUMBNAIL_SIZE) ++level;
+        return level;
+    }
+
     // Data is interleaved RGBA
-    TextureRef Texture::createFromData(const glm::ivec2& size, const uint8_t* data)
+    TextureRef Texture::createFromData(const glm::ivec2& size, const uint8_t* data, const TextureOptions& options)
     {
         auto pRet = std::shared_ptr<Texture>(new Texture());
 
         pRet->m_size = size;
+        pRet->m_sampler = options.sampler;
 
         glGenTextures(1, &pRet->m_handle);
         glBindTexture(GL_TEXTURE_2D, pRet->m_handle);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Hum not a lot of thing will repeat in this game. But this should be set from sprite batch anyway
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        auto mipmaps = options.mipmaps;
+        if (size.x <= 1 && size.y <= 1) mipmaps = TextureMipmaps::None;
+
+        if (mipmaps == TextureMipmaps::GPU)
+        {
+            // Not in GL 1.1 headers, we have to fetch it
+            static auto glGenerateMipmapFn = (PFNGLGENERATEMIPMAPPROC)SDL_GL_GetProcAddress("glGenerateMipmap");
+            if (glGenerateMipmapFn)
+            {
+                glGenerateMipmapFn(GL_TEXTURE_2D);
+                pRet->m_mipCount = 1 + (int)std::floor(std::log2((float)std::max(size.x, size.y)));
+            }
+            else mipmaps = TextureMipmaps::CPU;
+        }
+
+        if (mipmaps == TextureMipmaps::CPU)
+        {
+            auto levels = generateMipChain(size, data);
+            for (int i = 0; i < (int)levels.size(); ++i)
+            {
+                const auto& level = levels[i];
+                glTexImage2D(GL_TEXTURE_2D, i + 1, GL_RGBA, level.size.x, level.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data.data());
+            }
+            pRet->m_mipCount = 1 + (int)levels.size();
+        }
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pRet->m_mipCount - 1);
+        pRet->applySampler();
 
         return pRet;
     }
 
-    TextureRef Texture::createFromFile(const std::string& filename)
+    TextureRef Texture::createFromFile(const std::string& filename, const TextureOptions& options)
     {
+        FileSystem::FileData fileData;
+        if (!FileSystem::readFile(filename, fileData))
+        {
+            CORE_ERROR("Failed to load texture: {}", filename);
+            return nullptr;
+        }
+
+        // Big ones stream in instead of stalling. Only the header is read here.
         int w, h, n;
-        auto image = stbi_load(filename.c_str(), &w, &h, &n, 4);
-        if (!image)
+        if (options.allowStreaming &&
+            stbi_info_from_memory(fileData.pData, (int)fileData.size, &w, &h, &n) &&
+            std::max(w, h) >= TEXTURE_STREAMING_MIN_SIZE)
+        {
+            return createStreaming(filename, { w, h }, options.sampler);
+        }
+
+        glm::ivec2 size;
+        std::vector<uint8_t> pixels;
+        if (!decodeMemory(fileData.pData, fileData.size, size, pixels))
         {
             CORE_ERROR("Failed to load texture: {}", filename);
             return nullptr;
         }
-        glm::ivec2 size{ w, h };
 
-        // Pre multiplied
-        uint8_t* pImageData = &(image[0]);
-        auto len = size.x * size.y;
-        for (decltype(len) i = 0; i < len; ++i, pImageData += 4)
+        return createFromData(size, pixels.data(), options);
+    }
+
+    bool Texture::decodeFile(const std::string& filename, glm::ivec2& outSize, std::vector<uint8_t>& outPixels, bool skipStreamed)
+    {
+        FileSystem::FileData fileData;
+        if (!FileSystem::readFile(filename, fileData))
         {
-            pImageData[0] = pImageData[0] * pImageData[3] / 255;
-            pImageData[1] = pImageData[1] * pImageData[3] / 255;
-            pImageData[2] = pImageData[2] * pImageData[3] / 255;
+            CORE_ERROR("Failed to load texture: {}", filename);
+            return false;
         }
 
-        auto pRet = createFromData(size, image);
-        stbi_image_free(image);
+        int w, h, n;
+        if (skipStreamed &&
+            stbi_info_from_memory(fileData.pData, (int)fileData.size, &w, &h, &n) &&
+            std::max(w, h) >= TEXTURE_STREAMING_MIN_SIZE)
+        {
+            outSize = { w, h };
+            outPixels.clear();
+            return true;
+        }
+
+        if (!decodeMemory(fileData.pData, fileData.size, outSize, outPixels))
+        {
+            CORE_ERROR("Failed to load texture: {}", filename);
+            return false;
+        }
+        return true;
+    }
+
+    TextureRef Texture::createStreaming(const std::string& filename, const glm::ivec2& size, const TextureSampler& sampler)
+    {
+        auto pRet = std::shared_ptr<Texture>(new Texture());
+        pRet->m_size = size;
+        pRet->m_sampler = sampler;
+        pRet->m_mipCount = getMipCount(size);
+        pRet->m_isStreaming = true;
+
+        // Allocate the whole chain now so the handle never changes
+        glGenTextures(1, &pRet->m_handle);
+        glBindTexture(GL_TEXTURE_2D, pRet->m_handle);
+        for (int level = 0; level < pRet->m_mipCount; ++level)
+        {
+            auto mipSize = getMipSize(size, level);
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mipSize.x, mipSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pRet->m_mipCount - 1);
+
+        auto pStream = std::make_shared<TextureStream>();
+        pStream->pTexture = pRet;
+        pStream->filename = filename;
+        pStream->size = size;
+        pStream->mipCount = pRet->m_mipCount;
+
+        // Show the cooked thumbnail if there is one, and its own mips below it
+        FileSystem::FileData thumbnailData;
+        ThumbnailHeader header;
+        if (FileSystem::readFile(filename + ".thumb", thumbnailData) && thumbnailData.size >= sizeof(ThumbnailHeader))
+        {
+            memcpy(&header, thumbnailData.pData, sizeof(ThumbnailHeader));
+            auto expectedSize = getMipSize(size, header.level);
+            if (header.magic == THUMBNAIL_MAGIC &&
+                header.level > 0 && header.level < pStream->mipCount &&
+                expectedSize == glm::ivec2(header.width, header.height) &&
+                thumbnailData.size >= sizeof(ThumbnailHeader) + (size_t)header.width * header.height * 4)
+            {
+                auto pPixels = thumbnailData.pData + sizeof(ThumbnailHeader);
+                glTexSubImage2D(GL_TEXTURE_2D, header.level, 0, 0, header.width, header.height, GL_RGBA, GL_UNSIGNED_BYTE, pPixels);
+                auto levels = generateMipChain(expectedSize, pPixels);
+                for (int i = 0; i < (int)levels.size(); ++i)
+                    glTexSubImage2D(GL_TEXTURE_2D, header.level + 1 + i, 0, 0, levels[i].size.x, levels[i].size.y, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].data.data());
+                pStream->thumbnailLevel = header.level;
+            }
+        }
+
+        // Nothing to show yet, transparent until the decode is done
+        if (pStream->thumbnailLevel < 0)
+        {
+            uint32_t transparent = 0;
+            glTexSubImage2D(GL_TEXTURE_2D, pStream->mipCount - 1, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &transparent);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, pStream->thumbnailLevel < 0 ? pStream->mipCount - 1 : pStream->thumbnailLevel);
+        pRet->applySampler();
+
+        getJobSystem()->schedule([pStream]()
+        {
+            glm::ivec2 decodedSize;
+            if (Texture::decodeFile(pStream->filename, decodedSize, pStream->pixels) && decodedSize == pStream->size)
+                pStream->mips = Texture::generateMipChain(decodedSize, pStream->pixels.data());
+            else
+                pStream->failed = true;
+            pStream->decoded = true;
+        });
+
+        s_streams.push_back(pStream);
         return pRet;
     }
 
+    void Texture::updateStreaming()
+    {
+        if (s_streams.empty()) return;
+
+        size_t budget = s_streamingBudget;
+        for (auto it = s_streams.begin(); it != s_streams.end() && budget > 0;)
+        {
+            auto pStream = *it;
+            auto pTexture = pStream->pTexture.lock();
+            if (!pTexture) // Nobody uses it anymore. The job might still be running, it holds its own ref.
+            {
+                it = s_streams.erase(it);
+                continue;
+            }
+            if (!pStream->decoded)
+            {
+                ++it;
+                continue;
+            }
+            if (pStream->failed)
+            {
+                CORE_ERROR("Failed to stream texture: {}", pStream->filename);
+                pTexture->m_isStreaming = false;
+                it = s_streams.erase(it);
+                continue;
+            }
+
+            glBindTexture(GL_TEXTURE_2D, pTexture->m_handle);
+
+            // Loose files have no cooked thumbnail, put up the low levels first
+            if (pStream->thumbnailLevel < 0)
+            {
+                pStream->thumbnailLevel = std::max(1, getThumbnailLevel(pStream->size));
+                for (int level = pStream->thumbnailLevel; level < pStream->mipCount; ++level)
+                {
+                    const auto& mip = pStream->mips[level - 1];
+                    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mip.size.x, mip.size.y, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+                }
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, pStream->thumbnailLevel);
+            }
+
+            // Full res, in tiles
+            auto tilesX = (pStream->size.x + STREAMING_TILE_SIZE - 1) / STREAMING_TILE_SIZE;
+            auto tilesY = (pStream->size.y + STREAMING_TILE_SIZE - 1) / STREAMING_TILE_SIZE;
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, pStream->size.x);
+            while (pStream->nextTile < tilesX * tilesY && budget > 0)
+            {
+                int x = (pStream->nextTile % tilesX) * STREAMING_TILE_SIZE;
+                int y = (pStream->nextTile / tilesX) * STREAMING_TILE_SIZE;
+                int w = std::min(STREAMING_TILE_SIZE, pStream->size.x - x);
+                int h = std::min(STREAMING_TILE_SIZE, pStream->size.y - y);
+                auto pPixels = pStream->pixels.data() + ((size_t)y * pStream->size.x + x) * 4;
+                glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pPixels);
+                budget -= std::min(budget, (size_t)w * h * 4);
+                ++pStream->nextTile;
+            }
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+            // Then the mips between full res and the thumbnail
+            while (pStream->nextTile == tilesX * tilesY && pStream->nextMip < pStream->thumbnailLevel && budget > 0)
+            {
+                const auto& mip = pStream->mips[pStream->nextMip - 1];
+                glTexSubImage2D(GL_TEXTURE_2D, pStream->nextMip, 0, 0, mip.size.x, mip.size.y, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+                budget -= std::min(budget, mip.data.size());
+                ++pStream->nextMip;
+            }
+
+            if (pStream->nextTile == tilesX * tilesY && pStream->nextMip >= pStream->thumbnailLevel)
+            {
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+                pTexture->m_isStreaming = false;
+                it = s_streams.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    void Texture::setStreamingBudget(size_t bytesPerFrame)
+    {
+        s_streamingBudget = std::max<size_t>(1, bytesPerFrame);
+    }
+
+    bool Texture::cookThumbnail(const uint8_t* pFileData, size_t fileSize, std::vector<uint8_t>& outThumbnail)
+    {
+        int w, h, n;
+        if (!stbi_info_from_memory(pFileData, (int)fileSize, &w, &h, &n) || std::max(w, h) < TEXTURE_STREAMING_MIN_SIZE) return false;
+
+        glm::ivec2 size;
+        std::vector<uint8_t> pixels;
+        if (!decodeMemory(pFileData, fileSize, size, pixels)) return false;
+
+        auto level = getThumbnailLevel(size);
+        auto levels = generateMipChain(size, pixels.data());
+        const auto& mip = levels[level - 1];
+
+        ThumbnailHeader header = { THUMBNAIL_MAGIC, level, mip.size.x, mip.size.y };
+        outThumbnail.resize(sizeof(ThumbnailHeader) + mip.data.size());
+        memcpy(outThumbnail.data(), &header, sizeof(ThumbnailHeader));
+        memcpy(outThumbnail.data() + sizeof(ThumbnailHeader), mip.data.data(), mip.data.size());
+        return true;
+    }
+
     // In OpenGL this doesn't change much, but we plan ahead in case we go DX where it will matter.
     TextureRef Texture::createDynamic(const glm::ivec2& size, TextureFormat format)
     {
@@ -62,19 +375,88 @@ namespace Engine
         glGenTextures(1, &handle);
         glBindTexture(GL_TEXTURE_2D, handle);
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
         pRet->m_isDynamic = true;
         pRet->m_size = size;
         pRet->m_handle = handle;
+        pRet->applySampler(); // Dynamic textures never have mips, Trilinear behaves like Linear
         
         return pRet;
     }
 
+    std::vector<TextureMipLevel> Texture::generateMipChain(const glm::ivec2& size, const uint8_t* pData)
+    {
+        std::vector<TextureMipLevel> levels;
+
+        glm::ivec2 srcSize = size;
+        const uint8_t* pSrc = pData;
+        while (srcSize.x > 1 || srcSize.y > 1)
+        {
+            TextureMipLevel level;
+            level.size = { std::max(1, srcSize.x / 2), std::max(1, srcSize.y / 2) };
+            level.data.resize(level.size.x * level.size.y * 4);
+
+            // 2x2 box. On odd sizes the last row/column is clamped, that's good enough for sprites
+            for (int y = 0; y < level.size.y; ++y)
+            {
+                int y0 = std::min(y * 2, srcSize.y - 1);
+                int y1 = std::min(y * 2 + 1, srcSize.y - 1);
+                for (int x = 0; x < level.size.x; ++x)
+                {
+                    int x0 = std::min(x * 2, srcSize.x - 1);
+                    int x1 = std::min(x * 2 + 1, srcSize.x - 1);
+                    auto p00 = pSrc + (y0 * srcSize.x + x0) * 4;
+                    auto p10 = pSrc + (y0 * srcSize.x + x1) * 4;
+                    auto p01 = pSrc + (y1 * srcSize.x + x0) * 4;
+                    auto p11 = pSrc + (y1 * srcSize.x + x1) * 4;
+                    auto pOut = level.data.data() + (y * level.size.x + x) * 4;
+                    for (int c = 0; c < 4; ++c)
+                        pOut[c] = (uint8_t)(((int)p00[c] + (int)p10[c] + (int)p01[c] + (int)p11[c] + 2) / 4);
+                }
+            }
+
+            levels.push_back(std::move(level));
+            srcSize = levels.back().size;
+            pSrc = levels.back().data.data();
+        }
+
+        return levels;
+    }
+
     Texture::Texture() {}
+
+    void Texture::setSampler(const TextureSampler& sampler)
+    {
+        m_sampler = sampler;
+        glBindTexture(GL_TEXTURE_2D, m_handle);
+        applySampler();
+    }
+
+    // Expects the texture to be bound
+    void Texture::applySampler()
+    {
+        GLint minFilter = GL_LINEAR;
+        GLint magFilter = GL_LINEAR;
+        switch (m_sampler.filter)
+        {
+            case TextureFilter::Nearest:
+                minFilter = hasMipmaps() ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+                magFilter = GL_NEAREST;
+                break;
+            case TextureFilter::Linear:
+                minFilter = hasMipmaps() ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR;
+                break;
+            case TextureFilter::Trilinear:
+                minFilter = hasMipmaps() ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+                break;
+        }
+
+        GLint wrap = m_sampler.wrap == TextureWrap::Clamp ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    }
     
     void Texture::bind(int slot)
     {
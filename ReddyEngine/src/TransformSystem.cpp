@@ -0,0 +1,100 @@
+#include "Engine/TransformSystem.h"
+#include "Engine/Entity.h"
+#include "Engine/JobSystem.h"
+#include "Engine/ReddyEngine.h"
+#include "Engine/Scene.h"
+
+
+namespace Engine
+{
+    TransformSystem::TransformSystem(Scene* pScene)
+        : m_pScene(pScene)
+    {
+    }
+
+    void TransformSystem::update()
+    {
+        if (!hasPending()) return;
+        if (m_orderDirty) rebuildOrder();
+        m_hasDirty = false;
+
+        if (m_order.empty()) return;
+
+        auto pRoot = m_order[0];
+        if (pRoot->refreshWorldTransform()) pRoot->markSpatialDirty();
+
+        const auto& pJobSystem = getJobSystem();
+        if (!pJobSystem || m_batches.size() < 2 || (int)m_order.size() < PARALLEL_MIN_ENTITIES)
+        {
+            for (int i = 1; i < (int)m_order.size(); ++i)
+            {
+                auto pEntity = m_order[i];
+                if (pEntity->refreshWorldTransform()) pEntity->markSpatialDirty();
+            }
+            return;
+        }
+
+        // Batches only read their own entities and root, which is done. The spatial grid
+        // isn't thread safe, so changes are collected and pushed after.
+        pJobSystem->parallelFor((int)m_batches.size(), [this](int b)
+        {
+            auto& batch = m_batches[b];
+            for (int i = batch.begin; i < batch.end; ++i)
+            {
+                auto pEntity = m_order[i];
+                if (pEntity->refreshWorldTransform()) batch.changed.push_back(pEntity);
+            }
+        });
+
+        for (auto& batch : m_batches)
+        {
+            for (auto pEntity : batch.changed) pEntity->markSpatialDirty();
+            batch.changed.clear();
+        }
+    }
+
+    void TransformSystem::rebuildOrder()
+    {
+        m_orderDirty = false;
+        ++m_orderStamp;
+        m_order.clear();
+        m_batches.clear();
+
+        const auto& pRoot = m_pScene->getRoot();
+        if (!pRoot) return;
+
+        pRoot->m_orderStamp = m_orderStamp;
+        m_order.push_back(pRoot.get());
+
+        int batchBegin = 1;
+        for (const auto& pChild : pRoot->getChildren())
+        {
+            appendSubtree(pChild.get());
+            if ((int)m_order.size() - batchBegin >= BATCH_MIN_ENTITIES)
+            {
+                m_batches.push_back({ batchBegin, (int)m_order.size(), {} });
+                batchBegin = (int)m_order.size();
+            }
+        }
+        if ((int)m_order.size() > batchBegin)
+            m_batches.push_back({ batchBegin, (int)m_order.size(), {} });
+    }
+
+    void TransformSystem::appendSubtree(Entity* pEntity)
+    {
+        // No recursion, scenes can get deep
+        m_stack.push_back(pEntity);
+        while (!m_stack.empty())
+        {
+            auto pCurrent = m_stack.back();
+            m_stack.pop_back();
+
+            pCurrent->m_orderStamp = m_orderStamp;
+            m_order.push_back(pCurrent);
+
+            const auto& children = pCurrent->getChildren();
+            for (auto rit = children.rbegin(); rit != children.rend(); ++rit)
+                m_stack.push_back(rit->get());
+        }
+    }
+}
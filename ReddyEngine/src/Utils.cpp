@@ -5,6 +5,7 @@
 #include <objbase.h>
 #include <dirent/dirent.h>
 #endif
+#include "Engine/FileSystem.h"
 #include "Engine/Log.h"
 #include "Engine/Utils.h"
 
@@ -12,6 +13,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <memory>
 #include <regex>
 #include <filesystem>
 
@@ -403,23 +405,21 @@ namespace Engine
 
         bool loadJson(Json::Value& out, const std::string& filename)
         {
-            std::ifstream file(filename);
-            if (!file.is_open())
+            FileSystem::FileData fileData;
+            if (!FileSystem::readFile(filename, fileData))
             {
                 CORE_ERROR("Failed to load file: {}", filename);
                 return false;
             }
-            try
-            {
-                file >> out;
-            }
-            catch (...)
+
+            auto pBegin = (const char*)fileData.pData;
+            Json::CharReaderBuilder builder;
+            std::unique_ptr<Json::CharReader> pReader(builder.newCharReader());
+            if (!pReader->parse(pBegin, pBegin + fileData.size, &out, nullptr))
             {
                 CORE_ERROR("Failed to parse file: {}", filename);
-                file.close();
                 return false;
             }
-            file.close();
             return true;
         }
 
@@ -12,6 +12,7 @@
 #include <Engine/ReddyEngine.h>
 #include <Engine/ResourceManager.h>
 #include <Engine/Scene.h>
+#include <Engine/SceneBinary.h>
 #include <Engine/SpriteBatch.h>
 #include <Engine/Utils.h>
 #include <Engine/Entity.h>
@@ -925,6 +926,10 @@ void EditorState::save()
 
     Engine::Utils::saveJson(json, m_filename);
 
+    // Keep the cooked binary in sync, runtime loads prefer it
+    if (m_editDocumentType == EditDocumentType::Scene)
+        Engine::SceneBinary::convertFile(m_filename, Engine::SceneBinary::getBinaryFilename(m_filename));
+
     addRecentFile(m_filename);
 }
 
@@ -66,7 +66,7 @@ void Game::changeState(Engine::StateChangeRequest stateChangeRequest, const std:
     switch (stateChangeRequest)
     {
         case Engine::StateChangeRequest::ContinueGame:
-            changeState(std::make_shared<InGameState>(Engine::Utils::getSavePath("Reddy") + "world.json"));
+            changeState(std::make_shared<InGameState>(InGameState::getSaveFilename()));
             break;
         case Engine::StateChangeRequest::NewGame:
             changeState(std::make_shared<InGameState>(filename));
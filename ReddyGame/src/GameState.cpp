@@ -3,13 +3,18 @@
 #include "MainMenuState.h"
 
 #include <Engine/ReddyEngine.h>
+#include <Engine/AssetManifest.h>
 #include <Engine/EventSystem.h>
+#include <Engine/FileSystem.h>
 #include <Engine/SpriteBatch.h>
 #include <Engine/Scene.h>
 #include <Engine/LuaBindings.h>
 #include <Engine/Utils.h>
 #include <Engine/Log.h>
 #include <Engine/Input.h>
+#include <Engine/ResourceId.h>
+#include <Engine/ResourceManager.h>
+#include <Engine/SceneBinary.h>
 
 #include <glm/gtx/transform.hpp>
 
@@ -29,6 +34,12 @@ void GameState::enter(const GameStateRef& previousState)
     Engine::getLuaBindings()->initComponents();
 
     // Load the game!
+    if (loadBinaryScene(m_filenameToLoad))
+    {
+        m_isLoaded = true;
+        return;
+    }
+
     Json::Value json;
     if (!Engine::Utils::loadJson(json, m_filenameToLoad))
     {
@@ -36,7 +47,41 @@ void GameState::enter(const GameStateRef& previousState)
         std::dynamic_pointer_cast<Game>(Engine::getGame())->changeState(std::make_shared<MainMenuState>());
         return;
     }
+
+    // Load all the assets in one parallel batch before entities start asking for them one by one
+    Engine::getResourceManager()->preload(Engine::AssetManifest::loadOrScan(m_filenameToLoad, json));
+
     Engine::getScene()->deserialize(json);
+    m_isLoaded = true;
+}
+
+bool GameState::loadBinaryScene(const std::string& filename)
+{
+    auto binaryFilename = Engine::SceneBinary::getBinaryFilename(filename);
+    Engine::FileSystem::FileData binaryData;
+    if (!Engine::FileSystem::fileExists(binaryFilename) || !Engine::FileSystem::readFile(binaryFilename, binaryData)) return false;
+
+    // The json is the source, ignore the binary if it was edited since it was cooked. Saves have no source.
+    auto sourceHash = Engine::SceneBinary::getSourceHash(binaryData.pData, binaryData.size);
+    Engine::FileSystem::FileData jsonData;
+    if (sourceHash && Engine::FileSystem::readFile(filename, jsonData) &&
+        Engine::hashBytes(jsonData.pData, jsonData.size) != sourceHash)
+        return false;
+
+    Engine::SceneBinaryReader reader;
+    if (!reader.open(binaryData.pData, binaryData.size)) return false;
+
+    const auto& manifestJson = reader.getExtras()["manifest"];
+    if (!manifestJson.isNull())
+    {
+        Engine::AssetManifest manifest;
+        manifest.deserialize(manifestJson);
+        Engine::getResourceManager()->preload(manifest);
+    }
+
+    if (!Engine::getScene()->deserializeBinary(binaryData.pData, binaryData.size)) return false;
+    m_sceneExtras = reader.getExtras();
+    return true;
 }
 
 void GameState::leave(const GameStateRef& newState)
@@ -3,6 +3,7 @@
 #include <Engine/Constants.h>
 
 #include <glm/vec2.hpp>
+#include <json/json.h>
 
 #include <memory>
 #include <string>
@@ -33,6 +34,10 @@ public:
     float zoom = Engine::TILE_SIZE;
 
 protected:
+    bool loadBinaryScene(const std::string& filename); // False if there's no up to date cooked scene for filename
+
     bool m_seeThrough = false;
     std::string m_filenameToLoad;
+    bool m_isLoaded = false;
+    Json::Value m_sceneExtras; // Of the binary scene, when we loaded one
 };
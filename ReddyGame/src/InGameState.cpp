@@ -17,10 +17,19 @@ extern "C" {
 #include <Engine/SpriteBatch.h>
 #include <Engine/LuaBindings.h>
 #include <Engine/Entity.h>
+#include <Engine/SaveGame.h>
 
 #include <glm/gtx/transform.hpp>
 
 
+const float InGameState::AUTOSAVE_INTERVAL = 30.0f;
+
+
+std::string InGameState::getSaveFilename()
+{
+    return Engine::Utils::getSavePath("Reddy") + "world.json";
+}
+
 InGameState::InGameState(const std::string& filename)
     : GameState(filename)
 {
@@ -34,17 +43,48 @@ void InGameState::enter(const GameStateRef& previousState)
 	Engine::getInput()->setMouseCursor("assets/textures/cursor.png", glm::ivec2(4, 0));
 
     Engine::Utils::loadJson(m_inGameMenuJson, "assets/scenes/inGameMenu.json");
+
+    // Never write over the save when it failed to load
+    if (m_isLoaded)
+    {
+        m_pSaveGame = std::make_shared<Engine::SaveGame>(getSaveFilename());
+        m_pSaveGame->begin(m_sceneExtras);
+    }
 }
 
 void InGameState::leave(const GameStateRef& newState)
 {
     DEREGISTER_EVENT(KeyDownEvent);
 
+    if (m_pSaveGame)
+    {
+        if (m_subState == SubState::InGame) m_pSaveGame->save(); // The menu isn't part of the game, we saved when it opened
+        m_pSaveGame->flush();
+        m_pSaveGame.reset();
+    }
+
     GameState::leave(newState);
 }
 
+void InGameState::update(float dt)
+{
+    GameState::update(dt);
+
+    if (!m_pSaveGame) return;
+    m_pSaveGame->update();
+
+    if (m_subState != SubState::InGame) return;
+    m_autosaveTimer += dt;
+    if (m_autosaveTimer >= AUTOSAVE_INTERVAL)
+    {
+        m_autosaveTimer = 0.0f;
+        m_pSaveGame->save();
+    }
+}
+
 void InGameState::showInGameMenu()
 {
+    if (m_pSaveGame) m_pSaveGame->save();
     m_subState = SubState::InGameMenu;
 
     auto pWorld = Engine::getScene()->getEntityByName("World", true);
@@ -11,6 +11,9 @@ namespace Engine
 {
     class IEvent;
 
+    class SaveGame;
+    using SaveGameRef = std::shared_ptr<SaveGame>;
+
     class Entity;
     using EntityRef = std::shared_ptr<Entity>;
 };
@@ -19,8 +22,13 @@ namespace Engine
 class InGameState final : public GameState
 {
 public:
+    static const float AUTOSAVE_INTERVAL; // Seconds
+
+    static std::string getSaveFilename();
+
     InGameState(const std::string& filename);
 
+    void update(float dt) override;
     void enter(const GameStateRef& previousState) override;
     void leave(const GameStateRef& newState) override;
     void hideInGameMenu();
@@ -38,4 +46,6 @@ private:
     SubState m_subState = SubState::InGame;
     Json::Value m_inGameMenuJson;
     Engine::EntityRef m_pInGameMenu;
+    Engine::SaveGameRef m_pSaveGame;
+    float m_autosaveTimer = 0.0f;
 };
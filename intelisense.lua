@@ -99,8 +99,10 @@ function EnableEntity(e) end
 function DisableEntity(e) end
 function EnableComponent(e, componentName) end -- Lua name, or built-ins: Sprite, Text, etc.
 function DisableComponent(e, componentName) end
+function SetTickPolicy(e, componentName, interval, offscreenInterval, dormantDistance) end -- Updates every interval frames, offscreenInterval off screen, none past dormantDistance (0 = never). Or set tickInterval, offscreenTickInterval, dormantDistance on the component table
 function CreateEntity(parent) end
 function CreateEntity(parent, prefabName) end
+function CreateEntities(parent, prefabName, count) end -- Returns an array of the new entities
 function Destroy(e) end -- Destroys the entity (Accepts: component, entity or entity name)
 function AddComponent(e, componentName) end -- Lua name, or built-ins: Sprite, Text, etc.
 function RemoveComponent(e, componentName) end
@@ -143,6 +145,7 @@ function FindEntityByName(root, entityName, pos, searchRadius) end -- Pass 0 for
 function FindEntitiesByName(root, entityName, pos, searchRadius) end -- Returns array. Pass 0 for Radius for whole world.
 function FindEntityByComponent(root, componentTypeName, pos, searchRadius) end -- Pass 0 for Radius for whole world
 function FindEntitiesByComponent(root, componentTypeName, pos, searchRadius) end -- eturns array. Pass 0 for Radius for whole world.
+function FindEntitiesWithComponents(componentTypeName, ...) end -- Returns array of the entities having all of them. Cached, cheap to call every frame.
 
 
 ---------------------------------------------------------------------